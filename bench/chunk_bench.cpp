@@ -0,0 +1,377 @@
+//
+// Chunk size benchmark.  Built once per size listed in FT_VOX_BENCH_CHUNK_SIZES
+// (chunk_bench_16, chunk_bench_32, ...), run each binary on the same seed and
+// compare the tables.
+//
+// usage: chunk_bench_<size> [seed] [area in blocks] [view distance in blocks]
+//
+
+#include "Chunk.hpp"
+#include "ChunkCuller.hpp"
+#include "MeshArena.hpp"
+#include "MeshCache.hpp"
+#include "World.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+// Every heap allocation of the process, to check that snapshots and meshing
+// do not allocate once the mesh arenas are warm.  The std::async launch of
+// World's mesh jobs is not measured, it allocates on every job.
+static std::atomic<std::size_t> heapAllocations{0};
+
+void *operator new(std::size_t size) {
+    ++heapAllocations;
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+using BenchClock = std::chrono::steady_clock;
+
+static double elapsedMs(const BenchClock::time_point start) {
+    return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+int main(int argc, char **argv) {
+    TerrainGenerationParams params;
+    params.seed = argc > 1 ? std::atoi(argv[1]) : 1337;
+    const int areaBlocks = argc > 2 ? std::atoi(argv[2]) : 256;
+    const int viewBlocks = argc > 3 ? std::atoi(argv[3]) : DEFAULT_VIEW_DISTANCE_BLOCKS;
+    const TerrainParamsHandle sharedParams = std::make_shared<const TerrainGenerationParams>(params);
+
+    // Square area around the origin, plus a ring of chunks so every chunk of
+    // the area has its four neighbours when meshed.
+    const int chunksAcross = std::max(1, areaBlocks / Chunk::WIDTH);
+    const int first = -chunksAcross / 2 - 1;
+    const int last = first + chunksAcross + 1;
+    const int side = last - first + 1;
+
+    std::vector<std::shared_ptr<Chunk>> chunks(side * side);
+    auto at = [&](int cx, int cz) -> std::shared_ptr<Chunk> & {
+        return chunks[(cx - first) + side * (cz - first)];
+    };
+
+    // --- Generation ---
+    BenchClock::time_point start = BenchClock::now();
+    for (int cz = first; cz <= last; ++cz)
+        for (int cx = first; cx <= last; ++cx)
+            at(cx, cz) = std::make_shared<Chunk>(cx, cz, sharedParams);
+    const double generationMs = elapsedMs(start);
+
+    const int dirX[] = { 0, 0, 1, -1 };
+    const int dirZ[] = { 1, -1, 0, 0 };
+    for (int cz = first + 1; cz < last; ++cz)
+        for (int cx = first + 1; cx < last; ++cx)
+            for (int dir = 0; dir < 4; ++dir)
+                at(cx, cz)->setAdjacentChunks(dir, at(cx + dirX[dir], cz + dirZ[dir]));
+
+    // --- Meshing (area only, the outer ring has no neighbours), once per mesher ---
+    const int meshedChunks = chunksAcross * chunksAcross;
+    const MeshingMode modes[] = { MeshingMode::NAIVE, MeshingMode::GREEDY, MeshingMode::BINARY };
+    const char *modeNames[] = { "naive", "greedy", "binary" };
+    constexpr int modeCount = 3;
+    double meshingMs[modeCount] = {};
+    std::size_t vertices[modeCount] = {};
+    std::size_t meshingAllocations[modeCount] = {};
+
+    // Snapshots are what World takes on the main thread before a mesh job
+    std::vector<ChunkSnapshot> snapshots(meshedChunks);
+    auto snapshotOf = [&](int cx, int cz) -> ChunkSnapshot & {
+        return snapshots[(cx - first - 1) + chunksAcross * (cz - first - 1)];
+    };
+    start = BenchClock::now();
+    for (int cz = first + 1; cz < last; ++cz)
+        for (int cx = first + 1; cx < last; ++cx)
+            at(cx, cz)->takeSnapshot(snapshotOf(cx, cz));
+    const double snapshotMs = elapsedMs(start);
+
+    for (int m = 0; m < modeCount; ++m) {
+        Chunk::setMeshingMode(modes[m]);
+        // Untimed pass so the mesher is not charged for cold caches and arenas
+        for (int cz = first + 1; cz < last; ++cz)
+            for (int cx = first + 1; cx < last; ++cx)
+                at(cx, cz)->buildMeshData(snapshotOf(cx, cz));
+
+        const std::size_t allocationsBefore = heapAllocations;
+        start = BenchClock::now();
+        for (int cz = first + 1; cz < last; ++cz) {
+            for (int cx = first + 1; cx < last; ++cx) {
+                at(cx, cz)->buildMeshData(snapshotOf(cx, cz));
+                vertices[m] += at(cx, cz)->getMeshDataVertexCount();
+            }
+        }
+        meshingMs[m] = elapsedMs(start);
+        meshingAllocations[m] = heapAllocations - allocationsBefore;
+    }
+
+    // World's path without the job launch: snapshot into a pooled arena,
+    // mesh, then drop the CPU parts as uploadMesh does once every strip is
+    // built.  Second pass counted.
+    std::size_t worldPathAllocations = 0;
+    for (int pass = 0; pass < 2; ++pass) {
+        const std::size_t allocationsBefore = heapAllocations;
+        for (int cz = first + 1; cz < last; ++cz) {
+            for (int cx = first + 1; cx < last; ++cx) {
+                MeshArena::Handle arena = MeshArena::acquire();
+                at(cx, cz)->takeSnapshot(arena->snapshot);
+                at(cx, cz)->buildMeshData(arena->snapshot);
+                at(cx, cz)->setMeshData(ChunkMeshData());
+            }
+        }
+        worldPathAllocations = heapAllocations - allocationsBefore;
+    }
+
+    // --- Direction culling: quads Chunk::draw submits from a camera above the
+    // area centre, 16 blocks over the surface ---
+    std::size_t submittedQuads = 0, meshQuads = 0;
+    {
+        const glm::vec3 camera(0.5f, at(0, 0)->getColumnHeight(0, 0) + 16.0f, 0.5f);
+        const Direction faceDirection[6] = { NORTH, SOUTH, NONE, NONE, EAST, WEST };
+        for (int cz = first + 1; cz < last; ++cz) {
+            for (int cx = first + 1; cx < last; ++cx) {
+                Chunk &chunk = *at(cx, cz);
+                chunk.buildMeshData(snapshotOf(cx, cz));
+                const ChunkMeshData &mesh = chunk.getMeshData();
+                const glm::vec3 lo(cx * Chunk::WIDTH, chunk.getMinBlockY(), cz * Chunk::DEPTH);
+                const glm::vec3 hi = lo + glm::vec3(Chunk::WIDTH, chunk.getMaxBlockY() + 1 - chunk.getMinBlockY(), Chunk::DEPTH);
+                const bool faceVisible[6] = { camera.z > lo.z, camera.z < hi.z, camera.y > lo.y,
+                                              camera.y < hi.y, camera.x > lo.x, camera.x < hi.x };
+                for (int face = 0; face < 6; ++face) {
+                    std::size_t quads = mesh.interiorFaceQuads[face];
+                    if (faceDirection[face] != NONE)
+                        quads += mesh.parts[faceDirection[face]].size() / (4 * Chunk::VERTEX_WORDS);
+                    meshQuads += quads;
+                    if (faceVisible[face])
+                        submittedQuads += quads;
+                }
+            }
+        }
+    }
+
+    // --- Level of detail: vertices per chunk at each level, then the cost of
+    // a view of radius r at full resolution against 2r with LOD rings ---
+    std::size_t lodVertices[Chunk::MAX_LOD + 1] = {};
+    double lodMs[Chunk::MAX_LOD + 1] = {};
+    {
+        ChunkSnapshot lodSnapshot;
+        for (int lod = 0; lod <= Chunk::MAX_LOD; ++lod) {
+            start = BenchClock::now();
+            for (int cz = first + 1; cz < last; ++cz) {
+                for (int cx = first + 1; cx < last; ++cx) {
+                    Chunk &chunk = *at(cx, cz);
+                    chunk.setLod(lod);
+                    chunk.takeSnapshot(lodSnapshot);
+                    chunk.buildMeshData(lodSnapshot);
+                    lodVertices[lod] += chunk.getMeshDataVertexCount();
+                }
+            }
+            lodMs[lod] = elapsedMs(start);
+        }
+        for (int cz = first + 1; cz < last; ++cz)
+            for (int cx = first + 1; cx < last; ++cx)
+                at(cx, cz)->setLod(0);
+    }
+
+    // --- Border strips: what a chunk pays when one neighbour links late ---
+    ChunkSnapshot borderSnapshot;
+    start = BenchClock::now();
+    for (int cz = first + 1; cz < last; ++cz) {
+        for (int cx = first + 1; cx < last; ++cx) {
+            for (int dir = 0; dir < 4; ++dir) {
+                at(cx, cz)->takeBorderSnapshot(borderSnapshot, static_cast<Direction>(dir));
+                at(cx, cz)->buildBorderStrip(borderSnapshot, static_cast<Direction>(dir));
+            }
+        }
+    }
+    const double stripMs = elapsedMs(start) / 4;
+
+    // --- Mesh cache: a chunk coming back with the same voxels takes its mesh
+    // from MeshCache and only hashes the snapshot ---
+    MeshCache meshCache;
+    for (int cz = first + 1; cz < last; ++cz) {
+        for (int cx = first + 1; cx < last; ++cx) {
+            ChunkMeshData mesh;
+            at(cx, cz)->buildMeshData(snapshotOf(cx, cz));
+            if (at(cx, cz)->extractMeshData(mesh))
+                meshCache.store(cx, cz, std::move(mesh));
+        }
+    }
+    int reusedMeshes = 0;
+    start = BenchClock::now();
+    for (int cz = first + 1; cz < last; ++cz) {
+        for (int cx = first + 1; cx < last; ++cx) {
+            ChunkMeshData mesh;
+            if (meshCache.take(cx, cz, mesh) && Chunk::refreshCachedMesh(snapshotOf(cx, cz), mesh)) {
+                at(cx, cz)->setMeshData(std::move(mesh));
+                reusedMeshes++;
+            }
+        }
+    }
+    const double cacheMs = elapsedMs(start);
+
+    // Streaming order used by World (nearest first): how many arrivals a
+    // chunk waits for its first mesh when it needs all four neighbours,
+    // against none now that the interior is meshed on arrival
+    std::vector<std::pair<int, int>> order;
+    for (int cz = first; cz <= last; ++cz)
+        for (int cx = first; cx <= last; ++cx)
+            order.emplace_back(cx, cz);
+    std::stable_sort(order.begin(), order.end(), [](const auto &a, const auto &b) {
+        return a.first * a.first + a.second * a.second < b.first * b.first + b.second * b.second;
+    });
+    std::vector<int> arrival(side * side);
+    for (std::size_t i = 0; i < order.size(); ++i)
+        arrival[(order[i].first - first) + side * (order[i].second - first)] = static_cast<int>(i);
+    long waitedArrivals = 0;
+    for (int cz = first + 1; cz < last; ++cz) {
+        for (int cx = first + 1; cx < last; ++cx) {
+            int lastNeighbour = 0;
+            for (int dir = 0; dir < 4; ++dir) {
+                const int nx = cx + dirX[dir] - first;
+                const int nz = cz + dirZ[dir] - first;
+                lastNeighbour = std::max(lastNeighbour, arrival[nx + side * nz]);
+            }
+            waitedArrivals += std::max(0, lastNeighbour - arrival[(cx - first) + side * (cz - first)]);
+        }
+    }
+
+    // --- Frustum, cave, horizon and occlusion culling of the area from a camera at
+    // its centre, looking along +X with the field of view of App.  Each pass
+    // adds one stage.  The culler reads the layout of the uploaded meshes,
+    // recorded here without GL.  The outer ring is meshed without the
+    // strips towards its missing neighbours, as World meshes new chunks. ---
+    {
+        ChunkSnapshot ringSnapshot;
+        for (int cz = first; cz <= last; ++cz) {
+            for (int cx = first; cx <= last; ++cx) {
+                if (cx == first || cx == last || cz == first || cz == last) {
+                    at(cx, cz)->takeSnapshot(ringSnapshot);
+                    at(cx, cz)->buildMeshData(ringSnapshot);
+                }
+                at(cx, cz)->recordMeshLayout();
+            }
+        }
+    }
+    ChunkCuller culler;
+    std::size_t cullVisible[4] = {};
+    double cullUs[4] = {};
+    double firstSections = 0.0;
+    for (int stages = 1; stages <= 4; ++stages) {
+        std::vector<std::weak_ptr<Chunk>> areaChunks(chunks.begin(), chunks.end());
+        culler.setChunks(areaChunks);
+        culler.setCaveCulling(stages >= 2);
+        culler.setHorizonCulling(stages >= 3);
+        culler.setOcclusionCulling(stages >= 4);
+        std::size_t visible = 0;
+        const glm::vec3 camera(0.5f, at(0, 0)->getColumnHeight(0, 0) + 16.0f, 0.5f);
+        const glm::mat4 projection = glm::perspective(glm::radians(80.0f), 16.0f / 9.0f, 0.1f,
+                                                      static_cast<float>(chunksAcross * Chunk::WIDTH));
+        const int frames = 1000;
+        start = BenchClock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            // Turning a little every frame so the result is not reused
+            const float yaw = 0.001f * frame;
+            const glm::mat4 view = glm::lookAt(camera, camera + glm::vec3(std::cos(yaw), -0.2f, std::sin(yaw)),
+                                               glm::vec3(0.0f, 1.0f, 0.0f));
+            const auto &visibleChunks = culler.cull(projection * view, camera);
+            visible += visibleChunks.size();
+            if (stages == 2) {
+                for (const auto &visibleChunk : visibleChunks)
+                    firstSections += static_cast<double>(visibleChunk.firstSection) / visibleChunks.size() / frames;
+            }
+        }
+        cullUs[stages - 1] = elapsedMs(start) * 1000.0 / frames;
+        cullVisible[stages - 1] = visible / frames;
+    }
+
+    // --- Estimates for the circular view distance used by World, counted
+    // from its geometry and not measured: the bench has no GL context to
+    // upload meshes and build draw lists ---
+    const int radius = std::max(1, viewBlocks / Chunk::WIDTH);
+    int chunksInView = 0;
+    for (int dx = -radius; dx <= radius; ++dx)
+        for (int dz = -radius; dz <= radius; ++dz)
+            if (dx * dx + dz * dz < radius * radius)
+                chunksInView++;
+    const int neighbourLinks = chunksInView * 4;
+
+    // Vertices for the view at full resolution and at twice the radius with
+    // the rings World uses, per-chunk averages above times chunk counts
+    double fullViewVertices = 0.0, lodViewVertices = 0.0;
+    for (int dx = -2 * radius; dx <= 2 * radius; ++dx) {
+        for (int dz = -2 * radius; dz <= 2 * radius; ++dz) {
+            if (dx * dx + dz * dz >= 4 * radius * radius)
+                continue;
+            const float distance = std::sqrt(static_cast<float>(dx * dx * Chunk::WIDTH * Chunk::WIDTH
+                                                                + dz * dz * Chunk::DEPTH * Chunk::DEPTH));
+            const int lod = std::min(Chunk::MAX_LOD, static_cast<int>(distance / LOD_RING_BLOCKS));
+            lodViewVertices += static_cast<double>(lodVertices[lod]) / meshedChunks;
+            if (dx * dx + dz * dz < radius * radius)
+                fullViewVertices += static_cast<double>(lodVertices[0]) / meshedChunks;
+        }
+    }
+
+    // Map entries kept by World before chunks get unloaded
+    const int unloadRadius = radius + UNLOAD_MARGIN_BLOCKS / Chunk::WIDTH;
+    int residentChunks = 0;
+    for (int dx = -unloadRadius; dx <= unloadRadius; ++dx)
+        for (int dz = -unloadRadius; dz <= unloadRadius; ++dz)
+            if (dx * dx + dz * dz <= unloadRadius * unloadRadius)
+                residentChunks++;
+
+    std::printf("chunk size              %d x %d x %d\n", Chunk::WIDTH, Chunk::HEIGHT, Chunk::DEPTH);
+    std::printf("seed / area             %d / %d x %d blocks\n", params.seed, chunksAcross * Chunk::WIDTH, chunksAcross * Chunk::DEPTH);
+    std::printf("generation              %.3f ms/chunk, %.3f ms per 16x16 columns\n",
+                generationMs / (side * side), generationMs / (side * side) / (Chunk::WIDTH * Chunk::DEPTH / 256.0));
+    std::printf("mesh snapshot           %.3f ms/chunk (main thread)\n", snapshotMs / meshedChunks);
+    for (int m = 0; m < modeCount; ++m) {
+        std::printf("meshing %-6s          %.3f ms/chunk, %.2f ms total for the area\n",
+                    modeNames[m], meshingMs[m] / meshedChunks, meshingMs[m]);
+        std::printf("vertices %-6s         %zu total, %zu per chunk, %.1f KiB of vertex data per chunk\n",
+                    modeNames[m], vertices[m], vertices[m] / meshedChunks,
+                    vertices[m] * Chunk::VERTEX_WORDS * sizeof(uint32_t) / 1024.0 / meshedChunks);
+        std::printf("heap allocs %-6s      %.2f per remesh\n", modeNames[m],
+                    static_cast<double>(meshingAllocations[m]) / meshedChunks);
+    }
+    std::printf("heap allocs world path  %.2f per snapshot + remesh + release, job launch not counted (%s)\n",
+                static_cast<double>(worldPathAllocations) / meshedChunks, modeNames[modeCount - 1]);
+    std::printf("direction culling       %.1f%% of %zu quads submitted from above the area centre (%s)\n",
+                100.0 * submittedQuads / std::max<std::size_t>(1, meshQuads), meshQuads, modeNames[modeCount - 1]);
+    for (int lod = 0; lod <= Chunk::MAX_LOD; ++lod)
+        std::printf("lod %d (%2dx cells)       %zu vertices per chunk, %.3f ms/chunk snapshot + mesh\n", lod, 1 << lod,
+                    lodVertices[lod] / meshedChunks, lodMs[lod] / meshedChunks);
+    std::printf("lod view vertices       %.0f at radius %d, %.0f at radius %d with lod rings (estimate)\n",
+                fullViewVertices, radius, lodViewVertices, 2 * radius);
+    std::printf("border strip rebuild    %.3f ms/strip (%s), vs a full snapshot + mesh of %.3f ms\n",
+                stripMs / meshedChunks, modeNames[modeCount - 1], (snapshotMs + meshingMs[modeCount - 1]) / meshedChunks);
+    std::printf("mesh cache reuse        %.3f ms/chunk for %d/%d chunks, vs %.3f ms to mesh (%s)\n",
+                cacheMs / meshedChunks, reusedMeshes, meshedChunks, meshingMs[modeCount - 1] / meshedChunks,
+                modeNames[modeCount - 1]);
+    std::printf("first mesh delay        %.1f chunk arrivals when waiting for 4 neighbours, 0 with border strips\n",
+                static_cast<double>(waitedArrivals) / meshedChunks);
+    std::printf("frustum culling         %zu of %zu chunks drawn, %.1f us per frame with the nearest-first sort\n",
+                cullVisible[0], cullVisible[0] + culler.getCulledCount(), cullUs[0]);
+    std::printf("cave culling            %zu of those drawn, from section %.1f on average, %.1f us per frame\n",
+                cullVisible[1], firstSections, cullUs[1]);
+    std::printf("horizon culling         %zu of those drawn, %.1f us per frame\n", cullVisible[2], cullUs[2]);
+    std::printf("occlusion culling       %zu of those drawn, %.1f%% of tested chunks hidden, %.3f ms per job (worker)\n",
+                cullVisible[3], culler.getOcclusionHitRate() * 100.0f, culler.getOcclusionMs());
+    std::printf("view distance           %d blocks = radius %d chunks\n", radius * Chunk::WIDTH, radius);
+    std::printf("draw calls              1 indirect call for %d chunks in view, 1 per chunk without GL 4.3 (estimate)\n",
+                chunksInView);
+    std::printf("generation futures      %d to fill the view (estimate)\n", chunksInView);
+    std::printf("map entries             %d resident chunks (estimate)\n", residentChunks);
+    std::printf("neighbour links         %d (estimate)\n", neighbourLinks);
+    std::printf("sizeof(Chunk)           %zu bytes\n", sizeof(Chunk));
+    return 0;
+}
@@ -13,6 +13,7 @@
 #include "World.hpp"
 #include "Skybox.hpp"
 #include "Shader.hpp"
+#include "FrameUniforms.hpp"
 #include "stb_image.h"
 
 #include <fstream>
@@ -64,7 +65,7 @@ public:
 private:
     void init();
     void loadResources();
-    static unsigned int loadTexture(const char* path);
+    static unsigned int loadTextureArray(const char* path, int cols, int rows);
     void render();
 
     void cleanup();
@@ -100,6 +101,7 @@ private:
     std::shared_ptr<Shader> textureShader;
     std::shared_ptr<Shader> gradientShader;
     std::shared_ptr<Shader> activeShader;   // pointer to the currently active shader program
+    FrameUniforms frameUniforms;            // camera and lighting block shared by the programs
 
 	std::optional<int> seed;
 
@@ -0,0 +1,61 @@
+#ifndef BINARY_MESHER_HPP
+#define BINARY_MESHER_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Block.hpp"
+
+class ChunkSnapshot;
+
+// One merged face: sizeU x sizeV block faces starting at chunk-local block
+// (x, y, z), u/v being the in-plane axes of the face (see Chunk::writeQuad).
+struct MeshQuad {
+	int16_t x, y, z;
+	uint8_t face;
+	uint16_t sizeU, sizeV;
+	BlockType type;
+};
+
+// Mesher working on 64-bit occupancy rows instead of single voxels.
+//
+// Each (y, z) row of the chunk is one uint64_t, bit x set when the block is
+// present, read from the padded ChunkSnapshot.  Exposed faces of a whole row come out of one shift and AND-NOT
+// against the row that hides them (the neighbouring row for Y/Z faces, the
+// row itself shifted by one for X faces).  Opaque blocks share one mask;
+// every non-opaque type gets its own mask so the "same transparent type"
+// culling rule of isFaceOccluded still holds.  The visible bits are then
+// sorted into one plane per block type and merged into rectangles with
+// count-trailing-zeros scans.
+class BinaryMesher {
+public:
+	// Appends the quads of the snapshot to out, except the outward faces of
+	// the border slices (Chunk::borderSlice)
+	void build(const ChunkSnapshot &snapshot, std::vector<MeshQuad> &out);
+
+private:
+	// Rows of one mask class over the y range, with the north/south border
+	// rows as padding: row (y, z) is at (y - minY) * (DEPTH + 2) + z + 1.
+	// east/west hold the border columns, one z bitmask per y.
+	struct ClassMasks {
+		bool used = false;
+		std::vector<uint64_t> rows;
+		std::vector<uint64_t> east, west;
+	};
+
+	// Class 0 is every opaque block, class t the non-opaque block type t
+	std::array<ClassMasks, BLOCK_TYPE_COUNT> classes;
+	std::array<std::vector<uint64_t>, BLOCK_TYPE_COUNT> visible; // per class, see computeVisible
+	std::array<std::vector<uint64_t>, BLOCK_TYPE_COUNT> planes;  // per block type, one slice
+
+	int minY = 0;
+	int rowCount = 0; // maxY - minY + 1
+
+	void buildMasks(const ChunkSnapshot &snapshot);
+	void computeVisible(int face);
+	void mergePlane(std::vector<uint64_t> &plane, int rows, int face, int slice, BlockType type,
+	                std::vector<MeshQuad> &out) const;
+};
+
+#endif
@@ -8,7 +8,6 @@
 #include <cmath>
 #include <limits>
 #include <fstream>
-#include <unordered_map>
 #include "Block.hpp"
 
 //TODO ADD RLE COMPRESSION
@@ -22,10 +21,7 @@ public:
 
 	//unused FOR NOW. Should be for performance reasons instead of single gets/sets
 	void decodeAll(std::vector<uint32_t>& out) const;
-	void encodeAll(
-		const std::vector<BlockType>& blocks,
-		std::vector<BlockType>& palette,
-		std::unordered_map<BlockType, uint32_t>& paletteMap);
+	void encodeAll(const std::vector<BlockType>& blocks, BlockPalette& palette);
 
     size_t size() const { return m_size; }
     uint8_t bitsPerEntry() const { return m_bitsPerEntry; }
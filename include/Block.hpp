@@ -1,8 +1,10 @@
 #ifndef BLOCK_HPP
 #define BLOCK_HPP
 #include <cstdint>
+#include <cstddef>
+#include <array>
 
-enum class BlockType {
+enum class BlockType : uint8_t {
     AIR,
     GRASS,
     DIRT,
@@ -12,7 +14,84 @@ enum class BlockType {
     WATER,
     BEDROCK,
     LOG,
-    LEAVES
+    LEAVES,
+    COUNT // Number of block types, keep last
+};
+
+static constexpr std::size_t BLOCK_TYPE_COUNT = static_cast<std::size_t>(BlockType::COUNT);
+
+// Static per-type properties, looked up by the mesher and the block selection
+// ray instead of switching on the type.
+struct BlockInfo {
+    const char* name;
+    // Atlas tile for each face, in mesher face order:
+    // front (+Z), back (-Z), top (+Y), bottom (-Y), right (+X), left (-X)
+    uint8_t faceTiles[6];
+    bool opaque;            // hides the faces of the blocks next to it
+    bool transparent;       // see-through, faces between two blocks of this type are culled
+    bool solid;             // can be targeted by the block selection ray
+    uint8_t lightEmission;  // 0-15
+};
+
+inline constexpr BlockInfo BLOCK_REGISTRY[BLOCK_TYPE_COUNT] = {
+    // name        front back top bottom right left   opaque transparent solid light
+    { "air",     { 0, 0, 0, 0, 0, 0 },                false, true,       false, 0 },
+    { "grass",   { 1, 1, 0, 2, 1, 1 },                true,  false,      true,  0 },
+    { "dirt",    { 2, 2, 2, 2, 2, 2 },                true,  false,      true,  0 },
+    { "stone",   { 3, 3, 3, 3, 3, 3 },                true,  false,      true,  0 },
+    { "sand",    { 4, 4, 4, 4, 4, 4 },                true,  false,      true,  0 },
+    { "snow",    { 5, 5, 5, 5, 5, 5 },                true,  false,      true,  0 },
+    { "water",   { 6, 6, 6, 6, 6, 6 },                false, true,       false, 0 },
+    { "bedrock", { 7, 7, 7, 7, 7, 7 },                true,  false,      true,  0 },
+    { "log",     { 8, 8, 8, 8, 8, 8 },                true,  false,      true,  0 },
+    { "leaves",  { 9, 9, 9, 9, 9, 9 },                false, true,       true,  0 },
+};
+
+constexpr const BlockInfo& getBlockInfo(const BlockType type) {
+    return BLOCK_REGISTRY[static_cast<uint8_t>(type)];
+}
+
+constexpr bool isOpaque(const BlockType type) { return getBlockInfo(type).opaque; }
+constexpr bool isSolid(const BlockType type) { return getBlockInfo(type).solid; }
+
+// True when a face of `self` is hidden by the block `neighbor` next to it
+constexpr bool isFaceOccluded(const BlockType self, const BlockType neighbor) {
+    return getBlockInfo(neighbor).opaque
+        || (neighbor == self && getBlockInfo(self).transparent);
+}
+
+static_assert(sizeof(BlockType) == 1, "BlockType must stay one byte, BlockStorage relies on it");
+static_assert(getBlockInfo(BlockType::GRASS).faceTiles[2] == 0, "registry must follow BlockType order");
+static_assert(getBlockInfo(BlockType::LEAVES).faceTiles[0] == 9, "registry must follow BlockType order");
+
+// Palette of a chunk: palette index <-> BlockType.  A type appears at most
+// once, so the reverse lookup is a flat array indexed by block id instead of
+// a hash map.
+struct BlockPalette {
+    static constexpr uint8_t ABSENT = 0xFF;
+
+    std::array<BlockType, BLOCK_TYPE_COUNT> entries{}; // Index -> BlockType
+    std::array<uint8_t, BLOCK_TYPE_COUNT> indices;     // BlockType -> Index, ABSENT if unused
+    uint8_t count = 0;
+
+    BlockPalette() { indices.fill(ABSENT); }
+
+    void clear() {
+        count = 0;
+        indices.fill(ABSENT);
+    }
+    std::size_t size() const { return count; }
+    BlockType operator[](const uint32_t index) const { return entries[index]; }
+
+    // Index of `type`, appended to the palette when missing
+    uint32_t indexOf(const BlockType type) {
+        uint8_t &index = indices[static_cast<uint8_t>(type)];
+        if (index == ABSENT) {
+            index = count;
+            entries[count++] = type;
+        }
+        return index;
+    }
 };
 
 struct Voxel {
@@ -30,4 +109,4 @@ private:
     BlockType type;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -12,6 +12,7 @@ class Camera {
 
 	void initWireframeCube();
 	std::unique_ptr<Shader> blockWireframeShader = nullptr;
+	GLint wireframeModelLocation = -1;
 
 public:
 
@@ -41,10 +42,11 @@ public:
     void processMouseMovement(float xoffset, float yoffset);
     void updateCameraVectors();
 	
-	bool getTargetedBlock(std::unique_ptr<World> &world, glm::ivec3& hitBlock, glm::ivec3& faceNormal, float maxDistance = 100); //faceNormal is currently unused
+	// Block under the crosshair found by the world update from the last view posted
+	bool getTargetedBlock(std::unique_ptr<World> &world, glm::ivec3& hitBlock, glm::ivec3& faceNormal);
 	void setTargettedBlock(std::unique_ptr<World> &world);
 	void removeTargettedBlock(std::unique_ptr<World> &world);
-	void drawWireframeSelectedBlockFace(std::unique_ptr<World> &world, glm::mat4 &view, glm::mat4 &projection);
+	void drawWireframeSelectedBlockFace(std::unique_ptr<World> &world); // camera matrices from FrameUniforms
 };
 
 
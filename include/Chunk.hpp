@@ -17,16 +17,31 @@
 #include <unordered_set>
 #include <queue>
 #include <memory>
+#include <array>
+#include <mutex>
 
 #include "Block.hpp"
 #include "BitPackedArray.hpp"
+#include "BinaryMesher.hpp"
 #include "TerrainParams.hpp"
 #include "Noise.hpp"
+#include "ChunkRenderer.hpp"
 #include <GLFW/glfw3.h>
 
 
+// Chunk dimensions are a build-time setting, see FT_VOX_CHUNK_SIZE and
+// FT_VOX_CHUNK_HEIGHT in CMakeLists.txt.
+#ifndef FT_VOX_CHUNK_SIZE
+# define FT_VOX_CHUNK_SIZE 16
+#endif
+#ifndef FT_VOX_CHUNK_HEIGHT
+# define FT_VOX_CHUNK_HEIGHT 256
+#endif
+
 class World;
 class BlockStorage;
+class ChunkSnapshot;
+class MeshArena;
 
 struct IVec3Hash {
     size_t operator()(const glm::ivec3& v) const {
@@ -54,6 +69,15 @@ enum Direction {
 	NONE
 };
 
+// NAIVE emits one quad per visible face, GREEDY merges coplanar faces of the
+// same block type into rectangles, BINARY produces the same kind of merged
+// mesh from 64-bit occupancy rows (see BinaryMesher)
+enum class MeshingMode {
+	NAIVE,
+	GREEDY,
+	BINARY
+};
+
 enum class BiomeType {
     PLAINS,
     DESERT,
@@ -64,20 +88,103 @@ enum class BiomeType {
 	MOUNTAIN
 };
 
+// Terrain settings shared by every chunk generated with them.  World hands
+// out a new handle only after the settings changed.
+using TerrainParamsHandle = std::shared_ptr<const TerrainGenerationParams>;
+
+// CPU side of a chunk mesh, split in parts: one border strip per Direction
+// holding the outward faces of that side, the only faces that depend on the
+// neighbour, and the interior holding every other face.
+struct ChunkMeshData {
+	static constexpr int INTERIOR = 4;
+	static constexpr int PART_COUNT = 5;
+	static constexpr uint8_t ALL_BORDER_STRIPS = 0x0F;
+	// Block layers of a visibility section, see Chunk::buildSectionConnectivity
+	static constexpr int SECTION_HEIGHT = 16;
+	static constexpr int SECTION_COUNT = FT_VOX_CHUNK_HEIGHT / SECTION_HEIGHT;
+	// Occluder cells per axis in x/z, see Chunk::buildOccluders
+	static constexpr int OCCLUDER_CELLS = 2;
+	// Block layers [bottom, top) made only of opaque blocks, empty when top <= bottom
+	struct SolidRange {
+		int16_t bottom = 0;
+		int16_t top = 0;
+	};
+
+	std::array<std::vector<uint32_t>, PART_COUNT> parts; // packed vertices, see Chunk::VERTEX_WORDS
+	uint8_t builtParts = 0; // bit per part present in the mesh
+	// The interior is sorted by face (writeQuad order), quads of each face.
+	// A border strip only holds the face of its Direction.  The quads of a
+	// face are sorted by the section of their top block.
+	std::array<uint32_t, 6> interiorFaceQuads{};
+	// Pairs of section faces joined through non-opaque blocks, bit
+	// Chunk::connectivityBit(a, b)
+	std::array<uint16_t, SECTION_COUNT> sectionConnectivity{};
+	// Solid layers under the surface of each occluder cell, x fastest
+	std::array<SolidRange, OCCLUDER_CELLS * OCCLUDER_CELLS> occluders{};
+	std::array<uint64_t, PART_COUNT> partHashes{}; // Chunk::hashMeshInputs of each built part
+	// Occupied Y range of the snapshot meshed, maxY < minY when empty
+	int16_t minY = 0;
+	int16_t maxY = -1;
+
+	std::size_t wordCount() const {
+		std::size_t words = 0;
+		for (const auto &part : parts)
+			words += part.size();
+		return words;
+	}
+};
+
+// Uploaded mesh on its way back from the GPU, see Chunk::startMeshRead
+struct ChunkMeshReadback {
+	ChunkRenderer::Readback gpu;
+	ChunkMeshData layout; // parts empty
+	std::array<uint32_t, 7> faceQuadStart{};
+};
+
+// Data a chunk rarely touches once it is generated, kept out of line so the
+// hot part of Chunk (voxels, column index, mesh handles) stays small.
+struct ChunkColdData {
+	TerrainParamsHandle params; // settings the chunk was generated with
+	std::vector<unsigned char> compressedBlocks; // zlib(palette + blockIndices) while cold
+	// Everything of the uploaded mesh but its parts.  Render thread.
+	ChunkMeshData uploadedMesh;
+};
+
 class Chunk {
 public:
-	static constexpr int WIDTH = 16; // Size of the chunck in blocks
-	static constexpr int HEIGHT = 256; // Height of the chunck in blocks
-	static constexpr int DEPTH = 16; // Depth of the chunck in blocks
+	static constexpr int WIDTH = FT_VOX_CHUNK_SIZE; // Size of the chunck in blocks
+	static constexpr int HEIGHT = FT_VOX_CHUNK_HEIGHT; // Height of the chunck in blocks
+	static constexpr int DEPTH = FT_VOX_CHUNK_SIZE; // Depth of the chunck in blocks
     static constexpr int BLOCK_COUNT = WIDTH * HEIGHT * DEPTH;
-	const int ATLAS_COLS = 10;
-	const int ATLAS_ROWS = 1;
-
-    Chunk(const int chunkX, const int chunkZ, const TerrainGenerationParams& params, const bool doGenerate = true);
+	static_assert(WIDTH >= 4 && WIDTH <= 64, "FT_VOX_CHUNK_SIZE must be in [4, 64]");
+	static_assert(HEIGHT >= 16 && HEIGHT <= 4096, "FT_VOX_CHUNK_HEIGHT must be in [16, 4096]");
+	static constexpr int SECTION_HEIGHT = ChunkMeshData::SECTION_HEIGHT;
+	static constexpr int SECTION_COUNT = ChunkMeshData::SECTION_COUNT;
+	static_assert(HEIGHT % SECTION_HEIGHT == 0, "FT_VOX_CHUNK_HEIGHT must be a multiple of the section height");
+	// Section connectivity: one bit per unordered pair of faces (writeQuad
+	// order), 15 bits in all
+	static constexpr uint16_t ALL_SECTION_FACES_CONNECTED = 0x7FFF;
+	static constexpr int connectivityBit(int faceA, int faceB) {
+		return faceA > faceB ? connectivityBit(faceB, faceA) : faceA * (11 - faceA) / 2 + faceB - faceA - 1;
+	}
+	// Packed mesh vertex, two uint32 decoded in shaders/simple.vert and
+	// shaders/gradient.vert.  Four vertices per face, indexed by the shared
+	// quad index buffer.
+	//   word 0: x bits 0-6, z bits 7-13, y bits 14-26 (chunk-local corner),
+	//           face bits 27-29
+	//   word 1: texture layer (atlas tile) bits 0-7, light bits 8-11, ambient occlusion bits 12-13
+	static constexpr int VERTEX_WORDS = 2;
+	static_assert(WIDTH < (1 << 7) && HEIGHT < (1 << 13), "corner positions must fit the packed vertex");
+	// Tiles of assets/textures/textures.png, split into texture layers
+	static constexpr int ATLAS_COLS = 10;
+	static constexpr int ATLAS_ROWS = 1;
+
+    Chunk(const int chunkX, const int chunkZ, TerrainParamsHandle params, const bool doGenerate = true);
 	Chunk();
 	~Chunk();
 
-    // Release GL resources
+    // Give the mesh range back to its ChunkRenderer.  Render thread, or the
+    // last owner of the chunk.
     void releaseGL();
 
     void carveWorm(Worm& worm, BlockStorage &blocks);
@@ -85,11 +192,39 @@ public:
 	void generateCaves(BlockStorage &blocks, const TerrainGenerationParams &terrainParams);
 
     BlockType getBlock(int x, int y, int z) const;
+	// Does not remesh, World::setBlockWorld marks the meshes dirty
 	void setBlock(int x, int y, int z, BlockType block);
 
 	bool isBlockVisible(glm::ivec3 blockPos);
 
-    void draw(const std::shared_ptr<Shader> &shaderProgram) const; // Draw the chunk using the given shader program
+	// Highest non-air block of a local column, -1 when the column is empty
+	int getColumnHeight(int x, int z) const { return heightMap[x + WIDTH * z]; }
+	// Occupied Y range of the whole chunk (maxBlockY < minBlockY when empty)
+	int getMinBlockY() const { return minBlockY; }
+	int getMaxBlockY() const { return maxBlockY; }
+	// Same for the uploaded mesh, read by the render thread while the voxels change
+	int getMeshMinY() const { return meshMinY; }
+	int getMeshMaxY() const { return meshMaxY; }
+	// World block coordinates of the chunk corner at y = 0
+	glm::ivec3 getGlobalCoords() const { return glm::ivec3(originX, 0, originZ); }
+
+    // Commands drawing the mesh, without the face directions that all point
+    // away from the camera.  cameraCell is the camera chunk column in x/z
+    // and its block layer in y.  Quads lying only below firstSection are
+    // left out.
+    void appendDrawCommands(ChunkRenderer::DrawList &list, const glm::ivec3 &cameraCell, int firstSection = 0) const;
+    // Section connectivity of the uploaded mesh, every face connected to
+    // the others before the first upload
+    uint16_t getSectionConnectivity(int section) const {
+        const ChunkMeshData &mesh = cold->uploadedMesh;
+        return (mesh.builtParts & (1 << ChunkMeshData::INTERIOR)) ? mesh.sectionConnectivity[section] : ALL_SECTION_FACES_CONNECTED;
+    }
+    // Solid block layers of an occluder cell of the uploaded mesh, each cell
+    // covers WIDTH / OCCLUDER_CELLS x DEPTH / OCCLUDER_CELLS columns
+    static constexpr int OCCLUDER_CELLS = ChunkMeshData::OCCLUDER_CELLS;
+    ChunkMeshData::SolidRange getOccluder(int cellX, int cellZ) const {
+        return cold->uploadedMesh.occluders[cellX + OCCLUDER_CELLS * cellZ];
+    }
 
 	void setAdjacentChunks(int direction, std::shared_ptr<Chunk> &chunk);
 	bool hasAllAdjacentChunkLoaded() const;
@@ -97,9 +232,107 @@ public:
 	void saveToStream(std::ostream& out) const;
 	void loadFromStream(std::istream& in);
 
-	void buildMesh(); // Build the mesh for rendering
-	void buildMeshData();
-	void uploadMesh();
+	// Slice along the face normal that belongs to a border strip, -1 for the
+	// Y faces (face order of writeQuad)
+	static constexpr int borderSlice(int face) {
+		return face == 0 ? DEPTH - 1 : face == 4 ? WIDTH - 1 : (face == 1 || face == 5) ? 0 : -1;
+	}
+
+	void buildMesh(ChunkRenderer &renderer); // Build the mesh for rendering
+	// Copy the voxels and the neighbour borders a mesh job needs.  World
+	// update thread only, the snapshot can then be meshed on any thread.
+	void takeSnapshot(ChunkSnapshot &snapshot) const;
+	// Builds the interior and the strips of the neighbours in the snapshot.
+	// The static versions only touch their arguments and run on any thread.
+	static void buildMeshData(const ChunkSnapshot &snapshot, ChunkMeshData &out);
+	void buildMeshData(const ChunkSnapshot &snapshot);
+	void buildMeshData(); // takeSnapshot + buildMeshData
+	// Copy only the two block layers on each side of the dir border
+	void takeBorderSnapshot(ChunkSnapshot &snapshot, Direction dir) const;
+	// Rebuild one border strip, the other parts are kept as they are
+	static void buildBorderStrip(const ChunkSnapshot &snapshot, Direction dir, ChunkMeshData &out);
+	void buildBorderStrip(const ChunkSnapshot &snapshot, Direction dir);
+	// Replace the CPU mesh with one built away from the chunk, uploadMesh
+	// still has to be called
+	void setMeshData(ChunkMeshData &&data);
+	// Hash of what a mesh part is built from: the chunk voxels for the
+	// interior, the two block layers of its side for a border strip, and the
+	// mesher.  Parts with the same hash come out the same.
+	static uint64_t hashMeshInputs(const ChunkSnapshot &snapshot, int part);
+	// Brings a mesh kept by MeshCache up to date with the snapshot.  False
+	// when the interior changed, otherwise the strips that changed are
+	// rebuilt and the ones without a neighbour in the snapshot dropped.
+	static bool refreshCachedMesh(const ChunkSnapshot &snapshot, ChunkMeshData &mesh);
+	// Moves the mesh out for MeshCache, false when the parts already left
+	// the CPU.  The GPU mesh stays.
+	bool extractMeshData(ChunkMeshData &out);
+	// Same from the uploaded mesh, read back from the GPU.  Render thread:
+	// startMeshRead queues the copy, false when nothing is uploaded, and
+	// finishMeshRead splits it into parts once the GPU is done with it.
+	// The chunk may be gone or remeshed in between.
+	bool startMeshRead(ChunkMeshReadback &read) const;
+	static bool finishMeshRead(ChunkRenderer &renderer, ChunkMeshReadback &read, ChunkMeshData &out);
+	ChunkMeshData getMeshData() const {
+		std::lock_guard<std::mutex> lock(meshMutex);
+		return meshData;
+	}
+	// Level of detail of the next snapshots: voxels are merged into cells of
+	// (1 << lod)^3 blocks before meshing.  Sides towards a chunk at another
+	// level are closed with skirts instead of reading the neighbour.
+	static constexpr int MAX_LOD = WIDTH >= 8 ? 3 : 2;
+	void setLod(int level) { lod = static_cast<uint8_t>(level); }
+	int getLod() const { return lod; }
+	// True once the interior has been built at least once
+	bool hasMesh() const {
+		std::lock_guard<std::mutex> lock(meshMutex);
+		return meshData.builtParts & (1 << ChunkMeshData::INTERIOR);
+	}
+	// The parts stay on the CPU until every strip is built, after that a
+	// strip can only change through a full buildMeshData
+	bool canPatchBorderStrips() const {
+		std::lock_guard<std::mutex> lock(meshMutex);
+		return (meshData.builtParts & (1 << ChunkMeshData::INTERIOR)) && meshPartsOnCpu && lod == 0;
+	}
+	// Direction bits of the linked neighbours that hold voxels
+	uint8_t getLinkedBorders() const;
+	// Same for the neighbours at the level of detail of this chunk, the sides
+	// meshed against their blocks instead of a skirt
+	uint8_t getSameLodBorders() const;
+	// Uploads every part into the mesh range of the chunk.  Render thread,
+	// nothing happens when the parts left the CPU since the last upload.
+	void uploadMesh(ChunkRenderer &renderer);
+	// Records the layout of the built mesh for the culler (Y range,
+	// connectivity, occluders) like uploadMesh, without uploading it.  For
+	// tools running without a GL context.
+	void recordMeshLayout();
+	// Vertices built by buildMeshData and not uploaded yet
+	std::size_t getMeshDataVertexCount() const {
+		std::lock_guard<std::mutex> lock(meshMutex);
+		return meshData.wordCount() / VERTEX_WORDS;
+	}
+	// Vertices currently uploaded to the GPU
+	std::size_t getMeshVertexCount() const { return meshVertexCount; }
+	// Bytes of vertex data uploaded to the GPU
+	std::size_t getMeshBytes() const { return meshVertexCount * VERTEX_WORDS * sizeof(uint32_t); }
+
+	// Mesher used by every following buildMeshData() call
+	static void setMeshingMode(MeshingMode mode);
+	static MeshingMode getMeshingMode();
+
+	// Cold tier: chunks outside the render radius keep their voxels as a zlib
+	// blob and drop their mesh. compressBlocks/inflateBlocks only read and
+	// are run on worker threads, the store/restore calls happen on the World
+	// update thread.  The GPU mesh is released on the render thread.
+	std::vector<unsigned char> compressBlocks() const;
+	static bool inflateBlocks(const std::vector<unsigned char> &blob, std::string &raw);
+	void storeCompressed(std::vector<unsigned char> &&blob);
+	void restoreFromRaw(const std::string &raw);
+	bool isCompressed() const { return compressed; }
+	// Bumped by every setBlock, a compressed blob taken before the last
+	// edit is stale
+	uint32_t getEditCount() const { return editCount; }
+	const std::vector<unsigned char> &getCompressedBlocks() const { return cold->compressedBlocks; }
+	const TerrainParamsHandle &getTerrainParams() const { return cold->params; }
 
 	bool preGenerated = false;
 
@@ -118,27 +351,109 @@ public:
 	static BiomeType computeBiome(const TerrainGenerationParams& terrainParams, float worldX, float worldZ, int height);
 
 private:
-	TerrainGenerationParams currentParams;
-
-	glm::ivec3 getGlobalCoords() const { return glm::ivec3(originX, 0, originZ); }
+	// --- Hot: read by every mesh build and block query ---
+	BlockPalette palette;
+    BitPackedArray blockIndices;
+	bool compressed = false;
+	uint8_t lod = 0;
+	uint32_t editCount = 0;
 
-	int sourceChunkX; // X coordinate of the chunk in the world
-	int sourceChunkZ; // Z coordinate of the chunk in the world
+    int originX; // X coordinate of the chunck origin
+    int originZ; // Z coordinate of the chunck origin
+	ChunkRenderer *meshRenderer = nullptr; // owner of meshAllocation
+	ChunkRenderer::Allocation meshAllocation;
+	std::size_t meshVertexCount = 0;
+	// The mesh range holds one run per face direction: quads [faceQuadStart[f], faceQuadStart[f + 1])
+	std::array<uint32_t, 7> faceQuadStart{};
+	// First quad of each section in the interior and strip runs of each
+	// face, SECTION_COUNT + 1 entries per run, see sectionStart()
+	std::vector<uint32_t> sectionQuadStart;
+	int meshMinY = 0; // of the uploaded mesh
+	int meshMaxY = -1;
+	int minBlockY = 0;
+	int maxBlockY = -1;
+	// Column index, filled by generate()/loadFromStream() and kept up to
+	// date by setBlock().  It survives compression.
+	std::array<int16_t, WIDTH * DEPTH> heightMap{};
 
 	std::weak_ptr<Chunk> adjacentChunks[4] = {};
+	// The mesh jobs and the update thread build the mesh while the render
+	// thread uploads it, meshData and meshPartsOnCpu are only used under meshMutex
+	mutable std::mutex meshMutex;
+	ChunkMeshData meshData;
+	bool meshPartsOnCpu = false;
+
+	// --- Cold ---
+	std::unique_ptr<ChunkColdData> cold;
+
+	void copyBorder(ChunkSnapshot &snapshot, Direction dir) const;
+	void copyLodBorder(ChunkSnapshot &snapshot, Direction dir, const Chunk &neighbor) const;
+	static void mergeLodCells(ChunkSnapshot &snapshot, int scale);
+	static void buildSectionConnectivity(const ChunkSnapshot &snapshot, ChunkMeshData &out, MeshArena &arena);
+	static void buildOccluders(const ChunkSnapshot &snapshot, ChunkMeshData &out);
+	uint32_t &sectionStart(int face, int run, int section) {
+		return sectionQuadStart[(face * 2 + run) * (SECTION_COUNT + 1) + section];
+	}
+	uint32_t sectionStart(int face, int run, int section) const {
+		return sectionQuadStart[(face * 2 + run) * (SECTION_COUNT + 1) + section];
+	}
+	void releaseMeshParts();
+	// Layout of meshData becomes the uploaded one, meshMutex held
+	void copyUploadedLayout();
+	void rebuildHeightMap(const std::vector<BlockType> &blocks);
+	void decodeBlocks(std::vector<BlockType> &out) const;
+
+	// Interior meshers, appending to arena.quads.  The border strips are
+	// built by buildBorderStrip.
+	static void buildNaiveMesh(const ChunkSnapshot &snapshot, MeshArena &arena);
+	static void buildGreedyMesh(const ChunkSnapshot &snapshot, MeshArena &arena);
+	static void buildBinaryMesh(const ChunkSnapshot &snapshot, MeshArena &arena);
+	static void buildBorderStrip(const ChunkSnapshot &snapshot, Direction dir, ChunkMeshData &out, MeshArena &arena);
+	static void meshSlice(const ChunkSnapshot &snapshot, int face, int slice, bool merge, MeshArena &arena);
+	// Packed vertices of the quads sorted by face, out is sized once from the
+	// quad count.  faceQuads receives the quads of each face.
+	static void writeQuads(const std::vector<MeshQuad> &quads, std::vector<uint32_t> &out,
+	                       std::array<uint32_t, 6> &faceQuads);
+	static void writeQuad(uint32_t *vertices, const MeshQuad &quad);
+};
 
-	std::vector<BlockType> palette; // Index -> BlockType
-	std::unordered_map<BlockType, uint32_t> paletteMap; // BlockType -> Index
-    BitPackedArray blockIndices;
-	
-    int originX; // X coordinate of the chunck origin
-    int originZ; // Z coordinate of the chunck origin
-    GLuint VAO = 0;
-    GLuint VBO = 0;
-	uint meshVerticesSize;
-    std::vector<float> meshVertices; // Vertices for the mesh
+// Immutable input of a mesh job: the occupied Y range of a chunk plus a one
+// block border on every side, (WIDTH + 2) x (range + 2) x (DEPTH + 2).  The
+// X/Z border comes from the neighbour chunks, the Y border is air, so the
+// mesher reads every neighbour of a block without bounds checks or locks.
+class ChunkSnapshot {
+	public:
+		static constexpr int PADDED_WIDTH = Chunk::WIDTH + 2;
+		static constexpr int PADDED_DEPTH = Chunk::DEPTH + 2;
+
+		bool isEmpty() const { return maxY < minY; }
+		int getMinY() const { return minY; }
+		int getMaxY() const { return maxY; }
+		int getColumnHeight(int x, int z) const { return heightMap[x + Chunk::WIDTH * z]; }
 
-    void addFace(int x, int y, int z, int face); // Add a face to the mesh vertices
+		// x in [-1, WIDTH], z in [-1, DEPTH], y in [minY - 1, maxY + 1]
+		BlockType at(int x, int y, int z) const {
+			return data[(x + 1) + PADDED_WIDTH * ((z + 1) + PADDED_DEPTH * (y - minY + 1))];
+		}
+		// The PADDED_WIDTH blocks of row (y, z), starting at x = -1
+		const BlockType *row(int y, int z) const {
+			return &data[PADDED_WIDTH * ((z + 1) + PADDED_DEPTH * (y - minY + 1))];
+		}
+		// Whether the border blocks of dir were copied from a neighbour
+		bool hasBorder(Direction dir) const { return borders & (1 << dir); }
+
+	private:
+		friend class Chunk;
+
+		BlockType &at(int x, int y, int z) {
+			return data[(x + 1) + PADDED_WIDTH * ((z + 1) + PADDED_DEPTH * (y - minY + 1))];
+		}
+
+		std::vector<BlockType> data;
+		std::array<int16_t, Chunk::WIDTH * Chunk::DEPTH> heightMap{};
+		int minY = 0;
+		int maxY = -1;
+		uint8_t borders = 0;
 };
 
 class BlockStorage {
@@ -0,0 +1,174 @@
+#ifndef CHUNK_CULLER_HPP
+#define CHUNK_CULLER_HPP
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Chunk.hpp"
+#include "ChunkRenderer.hpp"
+#include "OcclusionRasterizer.hpp"
+
+// Frustum, cave and occlusion culling of the rendered chunks.
+//
+// The bounds of the chunks are kept as a structure of arrays (box centres and
+// half extents, Y taken from the uploaded mesh) so that the six plane tests
+// run four chunks at a time with SSE, or one at a time without it.
+//
+// Chunks in the frustum then go through a walk of the visibility sections
+// (Chunk::SECTION_HEIGHT block layers) starting from the camera one.  The
+// walk leaves a section only through a face connected to the face it came
+// in by (Chunk::getSectionConnectivity), never turns back against a
+// direction it already went, and stays in the frustum.  Chunks it never
+// reaches are hidden, and the sections of a chunk below the lowest one
+// reached are not drawn, which removes the caves under the terrain.
+//
+// Chunks left are sorted nearest first, so that the depth test rejects the
+// fragments of farther chunks hidden behind them.
+//
+// The horizon pass then treats the solid cells of the chunks
+// (Chunk::getOccluder) as ground down to the bottom of the world.  Going
+// out from the camera, it raises a horizon made of the highest slope seen
+// in each direction, and hides the chunks whose top stays under it.  It is
+// cheap and runs in every cull, unless the camera is under the ground.
+//
+// Last, an OcclusionRasterizer job on a worker draws the solid cells of the
+// nearest chunks (Chunk::getOccluder) and tests every chunk left against
+// them.  The job runs while the frame is drawn and its answer hides chunks
+// from the next cull, when the chunk table did not change in between.
+class ChunkCuller {
+public:
+	// Refills the bounds and connectivity tables from the uploaded meshes,
+	// empty chunks and chunks not uploaded yet are only walked through
+	void setChunks(const std::vector<std::weak_ptr<Chunk>> &chunks);
+	// Refreshes the bounds and connectivity of chunks of the table whose
+	// mesh was uploaded again.  False when a chunk became empty or stopped
+	// being empty, which needs setChunks.
+	bool updateChunks(const std::vector<std::shared_ptr<Chunk>> &changed);
+	// Chunks of the table seen from cameraPos with viewProjection, nearest
+	// first.  Valid until the next call.
+	const std::vector<ChunkRenderer::VisibleChunk> &cull(const glm::mat4 &viewProjection, const glm::vec3 &cameraPos);
+
+	// Walk the sections after the frustum test
+	void setCaveCulling(bool enabled) { caveCulling = enabled; }
+	bool isCaveCulling() const { return caveCulling; }
+	// Hide the chunks under the horizon of the terrain in front of them
+	void setHorizonCulling(bool enabled) { horizonCulling = enabled; }
+	bool isHorizonCulling() const { return horizonCulling; }
+	// Test the chunks left against the software depth buffer
+	void setOcclusionCulling(bool enabled) { occlusionCulling = enabled; }
+	bool isOcclusionCulling() const { return occlusionCulling; }
+
+	// Changes whenever the list returned by cull does
+	uint64_t getVisibleVersion() const { return visibleVersion; }
+	std::size_t getVisibleCount() const { return visibleChunks.size(); }
+	// Chunks of the table outside the frustum at the last cull
+	std::size_t getCulledCount() const { return chunks.size() - insideIndices.size(); }
+	// Chunks in the frustum the section walk did not reach at the last cull
+	std::size_t getCaveHiddenCount() const { return caveHidden; }
+	// Chunks under the horizon at the last cull
+	std::size_t getHorizonHiddenCount() const { return horizonHidden; }
+	// Chunks hidden by the last occlusion job at the last cull
+	std::size_t getOcclusionHiddenCount() const { return occlusionHidden; }
+	// Worker time of the last occlusion job, and the share of the chunks it
+	// tested that it found hidden
+	double getOcclusionMs() const { return occlusion.ms; }
+	float getOcclusionHitRate() const {
+		return occlusion.tested ? static_cast<float>(occlusion.hiddenCount) / occlusion.tested : 0.0f;
+	}
+
+private:
+	// Grid cells of the loaded columns not in the table
+	static constexpr int32_t NO_COLUMN = -1;
+	static constexpr int32_t EMPTY_COLUMN = -2;
+
+	// Directions around the camera the horizon is kept for, a power of two
+	static constexpr int HORIZON_BINS = 1024;
+
+	// Nearest chunks drawn as occluders by an occlusion job
+	static constexpr std::size_t MAX_OCCLUDER_CHUNKS = 128;
+	// Camera move and turn (cosine of the angle between the view directions)
+	// past which an occlusion result no longer hides anything
+	static constexpr float MAX_OCCLUSION_MOVE = 0.5f;
+	static constexpr float MIN_OCCLUSION_TURN_COS = 0.9995f;
+
+	struct Box {
+		glm::vec3 min, max;
+	};
+	struct OcclusionResult {
+		uint64_t tableVersion = 0;
+		glm::vec3 cameraPos{0.0f}; // view the job tested
+		glm::vec3 viewDir{0.0f};
+		std::vector<uint8_t> hidden; // per chunk of the table
+		std::size_t tested = 0;
+		std::size_t hiddenCount = 0;
+		double ms = 0.0;
+	};
+
+	// Columns seen from the camera: horizontal distances to the footprint,
+	// pseudo-angle range (diamondAngle) and slope of the top
+	struct HorizonSpan {
+		float nearest, farthest;
+		float firstAngle, lastAngle;
+		float slope;
+		uint32_t position; // in sortedIndices, for the chunks tested
+	};
+
+	struct SectionNode {
+		int x, y, z; // grid column and section
+		int entryFace; // face the walk came in by, -1 for the camera section
+		uint8_t directions; // face directions the walk went along
+	};
+
+	std::vector<std::weak_ptr<Chunk>> chunks;
+	std::vector<float> centerX, centerY, centerZ;
+	std::vector<float> extentX, extentY, extentZ;
+	std::vector<uint16_t> connectivity; // Chunk::SECTION_COUNT per chunk
+	std::vector<ChunkMeshData::SolidRange> occluders; // Chunk::OCCLUDER_CELLS^2 per chunk
+	uint64_t tableVersion = 0;
+
+	// Table index of each loaded column in gridWidth x gridDepth columns
+	// from (gridMinX, gridMinZ)
+	std::vector<int32_t> grid;
+	int gridMinX = 0, gridMinZ = 0;
+	int gridWidth = 0, gridDepth = 0;
+
+	bool caveCulling = true;
+	std::vector<uint32_t> sectionVisits; // visitStamp of the walk that reached each grid section
+	uint32_t visitStamp = 0;
+	std::vector<SectionNode> walkQueue;
+	std::vector<int> firstSections; // lowest section reached per chunk, SECTION_COUNT if none
+
+	std::vector<uint32_t> insideIndices;
+	std::vector<std::pair<float, uint32_t>> sortedIndices; // distance, index
+	std::vector<std::pair<uint32_t, int>> visibleIndices; // index and first section of the returned list
+	std::vector<ChunkRenderer::VisibleChunk> visibleChunks;
+	uint64_t visibleVersion = 0;
+	std::size_t caveHidden = 0;
+
+	bool horizonCulling = true;
+	std::vector<float> horizon; // highest slope of the ground in front, per direction
+	std::vector<HorizonSpan> horizonCells, horizonChunks;
+	std::vector<uint8_t> belowHorizon; // per position in sortedIndices
+	std::size_t horizonHidden = 0;
+	std::size_t occlusionHidden = 0;
+
+	bool occlusionCulling = true;
+	OcclusionRasterizer rasterizer; // used by the job in flight only
+	OcclusionResult occlusion; // of the last job done
+	std::future<OcclusionResult> occlusionJob; // last, waited for before the rasterizer goes
+
+	// Y bounds, connectivity and occluders of table entry index
+	void readMesh(std::size_t index, const Chunk &chunk);
+	void testFrustum(const glm::vec4 (&planes)[6]);
+	bool walkSections(const glm::vec4 (&planes)[6], const glm::vec3 &cameraPos);
+	void cullBelowHorizon(const glm::vec3 &cameraPos);
+	void startOcclusionJob(const glm::mat4 &viewProjection, const glm::vec3 &cameraPos);
+	// Forward axis of a perspective view, from the row giving clip w
+	static glm::vec3 viewDirection(const glm::mat4 &viewProjection);
+};
+
+#endif
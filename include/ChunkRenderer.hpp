@@ -0,0 +1,175 @@
+#ifndef CHUNK_RENDERER_HPP
+#define CHUNK_RENDERER_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+class Chunk;
+
+// Every chunk mesh lives in one shared vertex buffer, drawn through a single
+// VAO with the shared quad index buffer.
+//
+// Meshes get a range of the buffer (an Allocation, in quads of four packed
+// vertices) rounded up to a size class, four per power of two.  A released
+// range is queued from any thread and goes back to the free list of its
+// class on the main thread, where the next mesh of the same class takes it
+// again.  Without one, the range is cut first-fit from the free space; the
+// ranges pooled in the classes are merged back into it before the buffer
+// doubles.  The chunk origin is a per-draw vertex attribute at
+// location 1.  With GL 4.3 the whole pass is one glMultiDrawElementsIndirect,
+// the origin fetched through baseInstance.  Otherwise each chunk sets the
+// origin as a constant attribute and issues one glMultiDrawElementsBaseVertex.
+// Draw commands are only rebuilt when the chunk list, a mesh range or the
+// camera cell changed.
+//
+// Writes go through a streaming staging ring: the words are copied into a
+// mapped range of the ring that the GPU is not reading, and the staged
+// ranges are copied into the vertex buffer on the GPU when the writes are
+// flushed.  The ring is orphaned when it wraps, so mapping never waits on
+// copies still in flight.
+class ChunkRenderer {
+public:
+	// Range of the shared buffer held by one mesh, in quads
+	struct Allocation {
+		uint32_t firstQuad = 0;
+		uint32_t quadCount = 0; // 0 when nothing is allocated
+	};
+	// Layout of GL's DrawElementsIndirectCommand
+	struct DrawCommand {
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance; // index in DrawList::origins
+	};
+	struct DrawList {
+		std::vector<DrawCommand> commands;
+		std::vector<glm::ivec4> origins; // per chunk, xyz world block origin
+	};
+	// Copy of a range on its way back to the CPU, see startRead
+	struct Readback {
+		GLuint buffer = 0;
+		GLsync fence = nullptr;
+		std::size_t wordCount = 0;
+	};
+	// Chunk to draw, from section firstSection up (see ChunkCuller)
+	struct VisibleChunk {
+		std::weak_ptr<Chunk> chunk;
+		int firstSection = 0;
+	};
+
+	ChunkRenderer() = default;
+	~ChunkRenderer();
+	ChunkRenderer(const ChunkRenderer &) = delete;
+	ChunkRenderer &operator=(const ChunkRenderer &) = delete;
+
+	// Main thread.  Makes allocation hold quadCount quads, moving it when
+	// quadCount falls in another size class; the old content is not kept.
+	// allocation.quadCount is the size of the class.
+	void reserve(Allocation &allocation, uint32_t quadCount);
+	// Main thread.  Words at wordOffset words into the allocation, staged
+	// until flushWrites.
+	void write(const Allocation &allocation, std::size_t wordOffset, const uint32_t *words, std::size_t wordCount);
+	// Main thread.  Copies the staged writes into the vertex buffer, done
+	// before every draw, read or growth of the buffer as well
+	void flushWrites();
+	// Main thread.  Copies the first wordCount words of the allocation into
+	// a buffer of readback on the GPU and fences the copy, without waiting.
+	void startRead(const Allocation &allocation, std::size_t wordCount, Readback &readback);
+	// Main thread.  False while the GPU has not done the copy, else the
+	// words are in out and the readback buffer is deleted.
+	bool finishRead(Readback &readback, std::vector<uint32_t> &out);
+	// Main thread.  Deletes the readback buffer without reading it.
+	static void cancelRead(Readback &readback);
+	// Any thread.  The range is queued until the main thread collects it in
+	// the next reserve or draw.
+	void release(Allocation &allocation);
+
+	// Draws the meshes of chunks in order, face directions pointing away
+	// from the camera left out.  listVersion changes whenever chunks does.
+	void draw(const std::vector<VisibleChunk> &chunks, uint64_t listVersion, const glm::vec3 &cameraPos);
+
+	// Deletes the GL objects, before the GL context goes away
+	void releaseGL();
+
+	// Changes whenever a mesh range is reserved or released
+	uint64_t getLayoutVersion() const { return layoutVersion.load(); }
+	bool usesIndirectDraws() const { return indirect; }
+	std::size_t getBufferBytes() const;
+	std::size_t getUsedBytes() const;
+	// Released ranges waiting in the size classes
+	std::size_t getPooledBytes() const;
+	// Share of the ranges reserved that came from a size class
+	float getPoolHitRate() const;
+	std::size_t getDrawCommandCount() const { return drawList.commands.size(); }
+	// GL calls issued by the last draw
+	std::size_t getDrawCallCount() const { return drawCalls; }
+
+private:
+	static constexpr uint32_t INITIAL_CAPACITY_QUADS = 1u << 16; // 2 MiB of vertices
+	static constexpr std::size_t STAGING_RING_BYTES = 4u << 20;
+	static constexpr uint32_t MIN_CLASS_QUADS = 64;
+
+	// Ring range to vertex buffer range
+	struct StagedCopy {
+		GLintptr source;
+		GLintptr destination;
+		GLsizeiptr bytes;
+	};
+
+	GLuint vao = 0;
+	GLuint vertexBuffer = 0;
+	GLuint indexBuffer = 0;
+	GLuint originBuffer = 0;
+	GLuint indirectBuffer = 0;
+	bool indirect = false;
+
+	GLuint stagingBuffer = 0;
+	uint8_t *stagingMap = nullptr; // ring from stagingMapStart, mapped while writes are staged
+	std::size_t stagingMapStart = 0;
+	std::size_t stagingHead = 0; // next free byte of the ring
+	std::vector<StagedCopy> stagedCopies;
+
+	mutable std::mutex allocationMutex;
+	uint32_t capacityQuads = 0;
+	uint32_t usedQuads = 0;
+	uint32_t indexCapacityQuads = 0;
+	std::map<uint32_t, uint32_t> freeRanges; // first quad -> quad count
+	std::vector<std::vector<uint32_t>> classFreeRanges; // first quads per size class
+	std::vector<Allocation> releasedRanges; // not collected yet
+	uint32_t pooledQuads = 0;
+	uint64_t reservedRanges = 0;
+	uint64_t pooledReuses = 0;
+	std::atomic<uint64_t> layoutVersion{1};
+
+	DrawList drawList;
+	std::vector<std::pair<std::size_t, std::size_t>> chunkCommands; // per origin: first command, count
+	std::vector<GLsizei> counts;
+	std::vector<const void *> offsets;
+	std::vector<GLint> baseVertices;
+	uint64_t drawnListVersion = 0;
+	uint64_t drawnLayoutVersion = 0;
+	glm::ivec3 drawnCell{0};
+	std::size_t drawCalls = 0;
+
+	void initGL();
+	void grow(uint32_t minimumQuads);
+	void bindIndexCapacity(uint32_t quadCount);
+	bool mapStagingRing();
+	static uint32_t sizeClass(uint32_t quadCount);
+	static uint32_t classQuads(uint32_t sizeClass);
+	void collectReleased();
+	bool allocateRange(uint32_t quadCount, uint32_t &firstQuad);
+	void freeRange(uint32_t firstQuad, uint32_t quadCount);
+	void returnPooledRanges();
+	void rebuildDrawList(const std::vector<VisibleChunk> &chunks, const glm::ivec3 &cameraCell);
+};
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef FRAME_UNIFORMS_HPP
+#define FRAME_UNIFORMS_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Uniform buffer holding what every program reads once per frame: camera
+// matrices and lighting.  It is bound to Shader::FRAME_BINDING, where each
+// Shader ties its "Frame" uniform block at link time, so one upload serves
+// the chunk, skybox and wireframe programs.
+class FrameUniforms {
+public:
+	// std140 layout of the Frame block, vec3 members padded to vec4
+	struct Block {
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec4 lightDir;
+		glm::vec4 lightColor;
+		glm::vec4 ambientColor;
+	};
+
+	FrameUniforms() = default;
+	~FrameUniforms();
+	FrameUniforms(const FrameUniforms &) = delete;
+	FrameUniforms &operator=(const FrameUniforms &) = delete;
+
+	// Main thread, before the frame is drawn
+	void update(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &lightDir,
+	            const glm::vec3 &lightColor, const glm::vec3 &ambientColor);
+	// Deletes the buffer, before the GL context goes away
+	void releaseGL();
+
+private:
+	GLuint buffer = 0;
+};
+
+#endif
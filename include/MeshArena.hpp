@@ -0,0 +1,45 @@
+#ifndef MESH_ARENA_HPP
+#define MESH_ARENA_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "BinaryMesher.hpp"
+#include "Chunk.hpp"
+
+// Scratch memory of one mesh build, reused from build to build so that the
+// snapshot and the mesher do not touch the heap once the pools are warm.
+// Launching the job still does: std::async starts a thread and allocates
+// the shared state of its future.
+//
+// Mesh jobs run on std::async threads, a fresh thread per job, so the arenas
+// live in a shared pool instead of thread_local storage.  The pool also keeps
+// the vertex buffers of the mesh parts a chunk released after upload.
+class MeshArena {
+public:
+	struct Release {
+		void operator()(MeshArena *arena) const;
+	};
+	using Handle = std::unique_ptr<MeshArena, Release>;
+
+	// An arena from the pool, given back when the handle is destroyed
+	static Handle acquire();
+
+	// Smallest pooled buffer holding at least words, else the largest one,
+	// else a new empty buffer.  Returned buffers are empty.
+	static std::vector<uint32_t> takeVertexBuffer(std::size_t words);
+	static void recycleVertexBuffer(std::vector<uint32_t> &&buffer);
+
+	ChunkSnapshot snapshot; // filled on the update thread, meshed on a worker
+	BinaryMesher binaryMesher;
+	std::vector<MeshQuad> quads; // faces of the part being built
+	std::vector<BlockType> sliceMask;
+	std::vector<uint8_t> sectionCells; // flood fill state of one section
+	std::vector<uint32_t> floodStack;
+
+private:
+	MeshArena() = default;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Chunk.hpp"
+
+// Finished chunk meshes kept after their chunk went cold or was unloaded, so
+// that a chunk coming back is uploaded without meshing it again.
+//
+// Entries carry the input hashes of their parts (Chunk::hashMeshInputs).  A
+// mesh job takes the entry of its chunk and keeps it if the voxels did not
+// change, rebuilding only the border strips whose side did (see
+// Chunk::refreshCachedMesh).  World writes the entries of a region next to
+// its region file.  Thread safe.
+class MeshCache {
+public:
+	static constexpr std::size_t DEFAULT_MAX_BYTES = 64u << 20;
+
+	// Replaces the entry of the chunk, the oldest entries are dropped past maxBytes
+	void store(int chunkX, int chunkZ, ChunkMeshData &&mesh);
+	// Moves the entry of the chunk out of the cache
+	bool take(int chunkX, int chunkZ, ChunkMeshData &out);
+
+	// Entries of the chunks in [firstX, firstX + size) x [firstZ, firstZ + size).
+	// Files written with another format or chunk size are ignored on load.
+	bool save(const std::string &filename, int firstX, int firstZ, int size) const;
+	bool load(const std::string &filename);
+
+	std::size_t getEntryCount() const;
+	std::size_t getBytes() const;
+	void setMaxBytes(std::size_t bytes);
+
+private:
+	struct Entry {
+		ChunkMeshData mesh;
+		std::size_t bytes = 0;
+		std::list<uint64_t>::iterator age;
+	};
+
+	static uint64_t toKey(int chunkX, int chunkZ) {
+		return static_cast<uint64_t>(static_cast<uint32_t>(chunkX)) << 32 | static_cast<uint32_t>(chunkZ);
+	}
+	void insert(uint64_t key, ChunkMeshData &&mesh);
+	void erase(std::unordered_map<uint64_t, Entry>::iterator it);
+
+	mutable std::mutex mutex;
+	std::unordered_map<uint64_t, Entry> entries;
+	std::list<uint64_t> ages; // oldest first
+	std::size_t bytes = 0;
+	std::size_t maxBytes = DEFAULT_MAX_BYTES;
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef OCCLUSION_RASTERIZER_HPP
+#define OCCLUSION_RASTERIZER_HPP
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Low resolution software depth buffer for occlusion tests on the CPU.
+//
+// Occluders are boxes known to be solid, drawn as the triangles of the faces
+// turned to the camera.  Rasterization is conservative for occlusion: a
+// pixel is only written when the triangle covers all of it, with the
+// farthest depth the triangle has over it.  A box is then visible when any
+// pixel its screen rectangle touches is not nearer than its nearest corner.
+// Rows are processed four pixels at a time with SSE when available.
+class OcclusionRasterizer {
+public:
+	static constexpr int WIDTH = 256;
+	static constexpr int HEIGHT = 128;
+
+	OcclusionRasterizer();
+
+	// Clears the depth buffer for a new view
+	void begin(const glm::mat4 &viewProjection, const glm::vec3 &cameraPos);
+	// Boxes crossing the near plane are left out
+	void drawOccluder(const glm::vec3 &min, const glm::vec3 &max);
+	bool isVisible(const glm::vec3 &min, const glm::vec3 &max) const;
+
+private:
+	glm::mat4 viewProjection{1.0f};
+	glm::vec3 cameraPos{0.0f};
+	std::vector<float> depth; // WIDTH x HEIGHT, 0 near to 1 far
+
+	// Corner in pixels and depth, false behind the near plane
+	bool project(const glm::vec3 &point, glm::vec3 &out) const;
+	void drawTriangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c);
+};
+
+#endif
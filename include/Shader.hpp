@@ -8,18 +8,36 @@
 #include <sstream>
 #include <iostream>
 #include <string>
+#include <unordered_map>
 
 
 class Shader {
 public:
+    // Uniform buffer binding of the "Frame" block, see FrameUniforms
+    static constexpr GLuint FRAME_BINDING = 0;
+
     GLuint ID;
 
     Shader(const char* vertexPath, const char* fragmentPath);
     void use() const;
 
+    // Location of an active uniform from the table filled at link time, -1
+    // when the program has none by that name.  Look it up once and keep it
+    // for uniforms set every frame.
+    GLint getUniformLocation(const std::string& name) const;
+
     void setInt(const std::string& name, int value) const;
     void setMat4(const std::string& name, const glm::mat4& mat) const;
     void setVec3(const std::string& name, const glm::vec3& vec) const;
+    // Program must be in use
+    void setInt(GLint location, int value) const;
+    void setMat4(GLint location, const glm::mat4& mat) const;
+    void setVec3(GLint location, const glm::vec3& vec) const;
+
+private:
+    std::unordered_map<std::string, GLint> uniformLocations;
+
+    void reflectUniforms();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -14,7 +14,8 @@ class Skybox {
 public:
     explicit Skybox(const std::vector<std::string>& faces);
 
-    void draw(const glm::mat4& view, const glm::mat4& projection) const;
+    // Camera matrices come from the Frame block (FrameUniforms)
+    void draw() const;
 
 private:
     GLuint skyboxVAO{}, skyboxVBO{};
@@ -8,6 +8,7 @@
 #include "Block.hpp"
 #include <vector>
 #include <cstdint>
+#include <tuple>
 
 // Spline control points: {continentalness, height}
 static const std::vector<std::pair<float, float>> continentalnessSpline = {
@@ -109,7 +110,23 @@ struct TerrainGenerationParams {
     float forestMoistureThreshold = 0.60f;
     float snowTemperatureThreshold = 0.28f;
 
-
+    // Every field, for World to tell when the UI changed one.  A new field
+    // must be added here.
+    auto fields() const {
+        return std::tie(seed, seaLevel, bedrockLevel, genSize, downsample,
+            continentalnessFrequency, continentalnessOctaves, continentalnessPersistence,
+            continentalnessLacunarity, continentalnessScalingFactor,
+            erosionFrequency, erosionOctaves, erosionPersistence, erosionLacunarity, erosionScalingFactor,
+            peakValleyFrequency, peakValleyOctaves, peakValleyPersistence, peakValleyLacunarity,
+            peakValleyScalingFactor,
+            temperatureFrequency, temperatureOctaves, temperaturePersistence, temperatureLacunarity,
+            temperatureScalingFactor,
+            humidityFrequency, humidityOctaves, humidityPersistence, humidityLacunarity, humidityScalingFactor,
+            biomeScaleChunks, snapClimateToCells, climateWarpFrequency, climateWarpStrength,
+            desertMoistureThreshold, forestMoistureThreshold, snowTemperatureThreshold);
+    }
+    bool operator==(const TerrainGenerationParams &other) const { return fields() == other.fields(); }
+    bool operator!=(const TerrainGenerationParams &other) const { return !(*this == other); }
 };
 
 #endif // TERRAIN_PARAMS_HPP
\ No newline at end of file
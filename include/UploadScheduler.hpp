@@ -0,0 +1,60 @@
+#ifndef UPLOAD_SCHEDULER_HPP
+#define UPLOAD_SCHEDULER_HPP
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class Chunk;
+class ChunkRenderer;
+
+// Spreads the mesh uploads of the render thread over frames.
+//
+// Chunks whose mesh is ready are queued by position, a chunk queued again
+// before its upload is only uploaded once with its latest mesh.  Each run
+// uploads the queued chunks nearest to the camera first, until the bytes or
+// the time of the frame budget are spent, and leaves the rest for the next
+// frames.  One chunk is always uploaded so that the queue drains even with
+// meshes larger than the budget.
+class UploadScheduler {
+public:
+	static constexpr std::size_t DEFAULT_BYTES_PER_FRAME = 4u << 20;
+	static constexpr double DEFAULT_MS_PER_FRAME = 2.0;
+
+	// pos is (chunkX, chunkZ)
+	void schedule(std::pair<int, int> pos, const std::shared_ptr<Chunk> &chunk);
+	// Uploads within the budget through the renderer staging ring, chunks
+	// unloaded or deflated since they were queued upload nothing.  The
+	// chunks uploaded are appended to uploaded.
+	void run(ChunkRenderer &renderer, const glm::vec3 &cameraPos, std::vector<std::shared_ptr<Chunk>> &uploaded);
+	void clear() { pending.clear(); }
+
+	void setBytesPerFrame(std::size_t bytes) { bytesPerFrame = bytes; }
+	std::size_t getBytesPerFrame() const { return bytesPerFrame; }
+	void setMsPerFrame(double ms) { msPerFrame = ms; }
+	double getMsPerFrame() const { return msPerFrame; }
+
+	// Of the last run
+	std::size_t getUploadedBytes() const { return uploadedBytes; }
+	std::size_t getUploadedChunks() const { return uploadedChunks; }
+	double getUploadMs() const { return uploadMs; }
+	// Chunks left for the next frames
+	std::size_t getQueueDepth() const { return pending.size(); }
+
+private:
+	std::map<std::pair<int, int>, std::weak_ptr<Chunk>> pending;
+	std::vector<std::pair<float, std::pair<int, int>>> order; // squared distance, position
+
+	std::size_t bytesPerFrame = DEFAULT_BYTES_PER_FRAME;
+	double msPerFrame = DEFAULT_MS_PER_FRAME;
+
+	std::size_t uploadedBytes = 0;
+	std::size_t uploadedChunks = 0;
+	double uploadMs = 0.0;
+};
+
+#endif
@@ -13,17 +13,35 @@
 #include <memory>
 #include <string>
 
+#include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <future>
 #include <fstream>
 #include <filesystem>
 #include <optional>
+#include <chrono>
 
 #include "TerrainParams.hpp"
+#include "MeshCache.hpp"
+#include "ChunkCuller.hpp"
+#include "UploadScheduler.hpp"
 
 using ChunkPos = std::pair<int, int>; // (chunkX, chunkZ)
 
-static constexpr int REGION_SIZE = 32;
+// Regions always cover 512x512 blocks, whatever the chunk size
+static constexpr int REGION_SIZE_BLOCKS = 512;
+static constexpr int REGION_SIZE = REGION_SIZE_BLOCKS / Chunk::WIDTH; // in chunks
+static_assert(REGION_SIZE_BLOCKS % Chunk::WIDTH == 0, "chunk size must divide the region size");
+
+// Distances expressed in blocks so that they do not change with the chunk size
+static constexpr int DEFAULT_VIEW_DISTANCE_BLOCKS = 256;
+static constexpr int UNLOAD_MARGIN_BLOCKS = 512;
+// Level of detail k is used from k * LOD_RING_BLOCKS blocks away.  A chunk
+// changes level once it is LOD_HYSTERESIS_BLOCKS past a ring boundary.
+static constexpr int LOD_RING_BLOCKS = 128;
+static constexpr int LOD_HYSTERESIS_BLOCKS = 16;
 
 template <>
 struct std::hash<ChunkPos> {
@@ -36,8 +54,10 @@ struct std::hash<ChunkPos> {
 
 struct RegionFileMetadata {
     char magic[4] = {'R','G','N','1'};
-    std::uint32_t version = 1;
+    std::uint32_t version = 3; // v2: one byte BlockType palette entries, v3: chunk dimensions
     std::uint32_t regionSize = REGION_SIZE;
+    std::uint32_t chunkWidth = Chunk::WIDTH;
+    std::uint32_t chunkHeight = Chunk::HEIGHT;
 };
 
 struct ChunkEntry {
@@ -47,26 +67,125 @@ struct ChunkEntry {
     std::uint32_t size;
 };
 
+// Block under the crosshair and the face the ray came in by
+struct TargetedBlock {
+    glm::ivec3 block;
+    glm::ivec3 faceNormal;
+};
+
+// What an update of the world hands to the render thread.  Once published
+// the update thread does not touch it again, the render thread reads it and
+// takes the mesh tasks out.
+struct RenderList {
+    // GL work on the chunk meshes, done by the render thread in order
+    struct MeshTask {
+        enum Type : uint8_t {
+            QUEUE_UPLOAD, // new mesh, uploaded within the UploadScheduler budget
+            UPLOAD,       // edited mesh, uploaded right away
+            READ_BACK,    // GPU mesh into the MeshCache, its parts left the CPU
+            RELEASE       // GPU mesh of a deflated chunk
+        };
+        Type type;
+        ChunkPos pos;
+        std::shared_ptr<Chunk> chunk;
+    };
+
+    uint64_t version = 0; // changes with chunks
+    std::vector<std::weak_ptr<Chunk>> chunks; // loaded chunks in the load radius
+    std::vector<MeshTask> meshTasks;
+    // First edit of the remesh batch uploaded by this list
+    std::optional<std::chrono::steady_clock::time_point> editTime;
+
+    std::size_t totalChunks = 0;
+    std::size_t compressedChunks = 0;
+    std::size_t compressedBytes = 0;
+    std::optional<int> surfaceHeight; // of the camera column
+    std::optional<TargetedBlock> target;
+};
+
+// Chunks around the camera: generation, cold tier, meshing and drawing.
+//
+// The world is updated on its own thread, started by startUpdateThread.  The
+// render thread posts the camera with setView every frame, which wakes the
+// update thread for one update: edits and settings posted since the last
+// one, chunk streaming, mesh jobs, then the block under the crosshair.  The
+// update ends by publishing a RenderList.  render() takes the last one
+// published (the mesh tasks of a list it missed are carried over) and works
+// from it alone, so the render thread never waits on the chunk map and the
+// frame time only depends on the GL work.  The GPU side of the chunk meshes
+// belongs to the render thread, the update thread asks for uploads, read
+// backs and releases through the list.
+//
+// Without the update thread, updateVisibleChunks runs one update on the
+// calling thread and render() picks its list up the same way.
 class World {
 public:
     World();
 	World(int seed);
 
+    // Stops the update thread
     ~World();
 
+    void startUpdateThread();
+    void stopUpdateThread();
+    // Render thread: camera and terrain settings of the next update
+    void setView(const glm::vec3 &cameraPos, const glm::vec3 &cameraDir);
+
     void dumpHeightmap(int centerChunkX, int centerChunkZ, int chunksX, int chunksZ, int downsample, int image) const;
     void dumpBiomeMap(int centerChunkX, int centerChunkZ, int chunksX, int chunksZ, int downsample);
 
 	std::vector<std::weak_ptr<Chunk>> getRenderedChunks();
 
+    // One update on the calling thread, when the update thread is not started
     void updateVisibleChunks(const glm::vec3& cameraPos, const glm::vec3& cameraDir);
-    void render(const std::shared_ptr<Shader> &shaderProgram) const;
+    // Render thread.  Takes the last render list published and does its mesh
+    // tasks and the uploads of the frame, then draws the rendered chunks
+    // inside the frustum of viewProjection in one pass of the ChunkRenderer,
+    // nearest first, skipping the face directions that point away from cameraPos
+    void render(const std::shared_ptr<Shader> &shaderProgram, const glm::vec3 &cameraPos,
+                const glm::mat4 &viewProjection);
+    const ChunkRenderer &getRenderer() const { return renderer; }
+    const ChunkCuller &getCuller() const { return culler; }
+    const UploadScheduler &getUploadScheduler() const { return uploadScheduler; }
+    // Remesh every rendered chunk on the mesh workers at the next update,
+    // the old meshes stay on screen until the new ones are uploaded
+    void rebuildRenderedMeshes() { rebuildRequested = true; }
+    // Chunk meshes GL objects, deleted before the GL context goes away.
+    // Stops the update thread first.
+    void releaseGL();
 
+    // Statistics of the render list taken by the last render().
     // Return the number of chunks currently in the rendered list.
     std::size_t getRenderedChunkCount() const;
     // Return the total number of chunks currently loaded in the world.
     std::size_t getTotalChunkCount() const;
+    // Cold tier statistics: chunks held compressed and their blob bytes.
+    std::size_t getCompressedChunkCount() const { return renderList.compressedChunks; }
+    std::size_t getCompressedBytes() const { return renderList.compressedBytes; }
+    // Y of the highest non-air block of the camera column, see getSurfaceHeight
+    std::optional<int> getCameraSurfaceHeight() const { return renderList.surfaceHeight; }
+    // Block under the crosshair of the last view the update thread went through
+    const std::optional<TargetedBlock> &getTargetedBlock() const { return renderList.target; }
+
+    // Vertices uploaded for the chunks in the rendered list.
+    std::size_t getRenderedVertexCount() const;
+    // Switch mesher and remesh the rendered chunks.
+    void setMeshingMode(MeshingMode mode);
+    // Coarser meshes for distant chunks, see LOD_RING_BLOCKS.  Chunks switch
+    // level as they are visited by updateVisibleChunks.
+    bool isLodEnabled() const { return lodEnabled; }
+    void setLodEnabled(bool enabled) { lodEnabled = enabled; }
+    // Hide the chunk sections the camera cannot see through open blocks, see ChunkCuller
+    bool isCaveCullingEnabled() const { return culler.isCaveCulling(); }
+    void setCaveCullingEnabled(bool enabled) { culler.setCaveCulling(enabled); }
+    // Hide the chunks under the horizon of the terrain in front of them
+    bool isHorizonCullingEnabled() const { return culler.isHorizonCulling(); }
+    void setHorizonCullingEnabled(bool enabled) { culler.setHorizonCulling(enabled); }
+    // Hide the chunks behind the solid terrain drawn by the software rasterizer
+    bool isOcclusionCullingEnabled() const { return culler.isOcclusionCulling(); }
+    void setOcclusionCullingEnabled(bool enabled) { culler.setOcclusionCulling(enabled); }
 
+    // Settings read by the update thread, from any thread.
     // Get or set the current chunk load radius.  The radius determines how
     // many chunks around the camera are loaded.  Values below 1 are clamped.
     int getLoadRadius() const { return loadRadius; }
@@ -79,25 +198,113 @@ public:
     void setMaxConcurrentGeneration(std::size_t n) { maxConcurrentGeneration = std::max<std::size_t>(1, n); }
 
 	void globalCoordsToLocalCoords(int &x, int &y, int &z, int globalX, int globalY, int globalZ, int &chunkX, int &chunkZ);
+	// Posted from any thread and applied at the start of the next update.
+	// Edits are remeshed on worker threads, the old meshes stay on screen
+	// until the new ones are uploaded.
+	void setBlockWorld(glm::ivec3 globalCoords, std::optional<glm::ivec3> faceNormal, BlockType type);
+	// Time from the first edit of the last remesh batch to its upload
+	double getEditLatencyMs() const { return editLatencyMs; }
+	// Meshes kept for cold and unloaded chunks, and how many were reused
+	const MeshCache &getMeshCache() const { return meshCache; }
+	std::size_t getReusedMeshCount() const { return reusedMeshes; }
+
+	// Queries on the chunk map, for the update thread or when it is not started
     std::shared_ptr<Chunk> getChunk(int chunkX, int chunkZ);
 	BlockType getBlockWorld(glm::ivec3 globalCoords); //unused for now
-	void setBlockWorld(glm::ivec3 globalCoords, std::optional<glm::ivec3> faceNormal, BlockType type);
 	bool isBlockVisibleWorld(glm::ivec3 globalCoords);
+	// Y of the highest non-air block of a world column, answered from the
+	// chunk column index.  Empty when the chunk is not loaded or the column is empty.
+	std::optional<int> getSurfaceHeight(int globalX, int globalZ);
+	// First visible block along the ray, maxDistance blocks at most
+	std::optional<TargetedBlock> raycastBlock(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance);
 
 	void saveRegionsOnExit();
-    // Terrain params for ImGui
+    // Terrain params for ImGui, render thread.  The update thread gets a
+    // copy with the next view.
     TerrainGenerationParams& getTerrainParams() { return terrainParams;}
 
 private:
+    // First so that it outlives the chunks holding ranges of its buffer
+    ChunkRenderer renderer;
     TerrainGenerationParams terrainParams;
+    // Immutable copy of terrainParams shared by the chunks, refreshed by
+    // getParamsHandle() when the UI changed a value.  Render thread.
+    TerrainParamsHandle paramsHandle;
+    TerrainParamsHandle getParamsHandle();
+
+    struct View {
+        glm::vec3 position;
+        glm::vec3 direction;
+        TerrainParamsHandle params;
+    };
+    struct BlockEdit {
+        glm::ivec3 coords;
+        std::optional<glm::ivec3> faceNormal;
+        BlockType type;
+        std::chrono::steady_clock::time_point time;
+    };
+    static constexpr float TARGET_DISTANCE = 100.0f;
+
+    std::thread updateThread;
+    std::mutex viewMutex;
+    std::condition_variable viewPosted;
+    View postedView;
+    bool viewPending = false;
+    bool stopRequested = false;
+    void runUpdateThread();
+    // Commands, updateChunks, then the render list
+    void update(const View &view);
+    // Streaming, cold tier and mesh jobs around the camera
+    void updateChunks(const glm::vec3 &cameraPos, const glm::vec3 &cameraDir);
+
+    std::mutex commandMutex;
+    std::vector<BlockEdit> postedEdits;
+    std::vector<BlockEdit> edits; // being applied
+    std::atomic<bool> rebuildRequested{false};
+    void applyCommands();
+    // False when the chunk has a cold tier job in flight, the edit waits
+    // for the next update
+    bool applyBlockEdit(const BlockEdit &edit);
+
+    // Filled by an update, then swapped with publishedList.  render() swaps
+    // publishedList with renderList, so that the three lists keep their buffers.
+    RenderList nextList;
+    std::mutex publishMutex;
+    RenderList publishedList;
+    bool listPublished = false;
+    RenderList renderList;
+    void publishRenderList();
+    void takeRenderList();
 
 	inline int floorDiv(int value, int divisor) {
 		if (value >= 0) return value / divisor;
 		return (value - divisor + 1) / divisor; // floor division for negatives
 	}
 
+    // Update thread
     std::unordered_map<ChunkPos, std::shared_ptr<Chunk>> chunks;
     std::vector<std::weak_ptr<Chunk>> renderedChunks;
+    uint64_t renderedChunksVersion = 0; // bumped when renderedChunks changes
+    TerrainParamsHandle updateParams; // of the update running
+
+    // Render thread
+    ChunkCuller culler;
+    // Version of the chunk list the culler table was built from, and the
+    // chunks whose mesh was uploaded or released since
+    uint64_t culledChunksVersion = 0;
+    std::vector<std::shared_ptr<Chunk>> changedMeshes;
+    // Meshes read back for meshCache, stored once the GPU copied them
+    struct PendingMeshRead {
+        ChunkPos pos;
+        ChunkMeshReadback read;
+    };
+    std::vector<PendingMeshRead> meshReads;
+    void finishMeshReads();
+    // Meshes finished by the generation and border jobs, uploaded nearest
+    // first within a budget per frame.  Edit remeshes skip it.
+    UploadScheduler uploadScheduler;
+    double editLatencyMs = 0.0;
+
     std::vector<std::pair<int, int>> chunksToGenerate;
 
     // Pending futures representing asynchronous chunk generation tasks.
@@ -107,16 +314,77 @@ private:
 
     // The radius (in chunks) around the camera in which to load chunks.  This
     // value can be changed at runtime via the UI.
-    int loadRadius = 16;
+    std::atomic<int> loadRadius{DEFAULT_VIEW_DISTANCE_BLOCKS / Chunk::WIDTH};
 	bool outOfMemory = false;
 
     // Maximum number of chunk generation tasks that can be running at the
     // same time.  Limiting concurrency prevents CPU oversubscription and
     // reduces frame drops when many chunks need to be generated.  This
     // value can be tuned based on the number of available CPU cores.
-    std::size_t maxConcurrentGeneration = 4;
+    std::atomic<std::size_t> maxConcurrentGeneration{4};
+
+    // Cold tier.  Chunks further than loadRadius + coldMargin are deflated on a
+    // worker thread and lose their GPU mesh; they are inflated again as soon as
+    // the camera is within loadRadius + warmMargin, so they are resident before
+    // they enter the render radius.  The gap between both margins avoids
+    // thrashing at the boundary.
+    static constexpr int coldMargin = 4;
+    static constexpr int warmMargin = 2;
+    std::size_t maxConcurrentCompression = 4;
+    std::vector<std::future<std::pair<ChunkPos, std::vector<unsigned char>>>> compressionFutures;
+    std::vector<std::future<std::pair<ChunkPos, std::string>>> decompressionFutures;
+    // Chunks with a job in flight, and their edit count when it started
+    std::unordered_map<ChunkPos, uint32_t> coldTransitions;
+    std::size_t compressedChunkCount = 0;
+    std::size_t compressedBytes = 0;
+
+    void updateColdTier(int currentChunkX, int currentChunkZ, std::unordered_set<ChunkPos> &restoredChunks);
+
+    // Meshes of the chunks that lost theirs, taken back by the mesh jobs
+    MeshCache meshCache;
+    std::atomic<std::size_t> reusedMeshes{0};
+    void cacheMesh(ChunkPos pos, const std::shared_ptr<Chunk> &chunk);
+
+    // First meshes of new and restored chunks, polled by each update.  A
+    // chunk gets no other mesh job while one is in flight, its later edits
+    // and full remeshes wait in dirtyMeshes.  Declared after meshCache,
+    // which the jobs use.
+    struct MeshJob {
+        ChunkPos pos;
+        std::shared_ptr<Chunk> chunk;
+        std::future<ChunkMeshData> mesh;
+    };
+    std::vector<MeshJob> meshJobs;
+    std::unordered_map<ChunkPos, const Chunk *> meshingChunks; // chunk of the job in flight
+
+    // Block edits waiting for a remesh: chunk -> Direction bits of the border
+    // strips to rebuild, or the ChunkMeshData::INTERIOR bit for a full mesh.
+    // All the edits of a frame go out as one batch of jobs, uploaded together
+    // once every job is done; the next batch waits for it.
+    struct RemeshJob {
+        ChunkPos pos;
+        std::shared_ptr<Chunk> chunk;
+        std::future<ChunkMeshData> mesh;
+    };
+    // Level of detail changes go through the same queue without counting as
+    // edits.  A batch holds at most maxRemeshBatch jobs.
+    std::unordered_map<ChunkPos, uint8_t> dirtyMeshes;
+    std::vector<RemeshJob> remeshJobs;
+    std::size_t maxRemeshBatch = 32;
+    bool dirtyMeshesHaveEdit = false;
+    bool remeshBatchHasEdit = false;
+    std::chrono::steady_clock::time_point firstDirtyEdit;
+    std::chrono::steady_clock::time_point remeshBatchEdit;
+
+    void markMeshDirty(ChunkPos pos, uint8_t parts, std::chrono::steady_clock::time_point editTime);
+    void updateDirtyMeshes();
+
+    std::atomic<bool> lodEnabled{true};
+    int selectLod(int currentLod, const glm::vec3 &cameraPos, int chunkX, int chunkZ) const;
+    void updateLevelOfDetail(int chunkX, int chunkZ, Chunk &chunk, const glm::vec3 &cameraPos);
 
-    std::unordered_set<ChunkPos> linkNeighbors(int chunkX, int chunkZ, std::shared_ptr<Chunk> &chunk);
+    void linkNeighbors(int chunkX, int chunkZ, std::shared_ptr<Chunk> &chunk,
+                       std::unordered_map<ChunkPos, uint8_t> &borderStrips);
     static ChunkPos toKey(int chunkX, int chunkZ);
 
 	std::unordered_set<ChunkPos> loadedRegions;
@@ -124,6 +392,7 @@ private:
 	void saveRegion(int regionX, int regionZ);
 	void loadRegion(int regionX, int regionZ);
 	std::string getRegionFilename(int regionX, int regionZ) const;
+	std::string getMeshCacheFilename(int regionX, int regionZ) const;
 	std::string regionDirName;
 };
 
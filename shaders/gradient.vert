@@ -1,15 +1,23 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoord;
-layout (location = 2) in float aY;
+// Packed chunk vertex, layout documented next to Chunk::VERTEX_WORDS
+layout (location = 0) in uvec2 aPacked;
+// World block origin of the chunk, one per draw (see ChunkRenderer)
+layout (location = 1) in ivec3 aChunkOrigin;
 
 out float blockY;
 
-uniform mat4 view;
-uniform mat4 projection;
+// Per frame, shared by all programs (FrameUniforms::Block)
+layout (std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    vec4 lightDir;
+    vec4 lightColor;
+    vec4 ambientColor;
+};
 
 void main() {
-    gl_Position = projection * view * vec4(aPos, 1.0);
+    vec3 localPos = vec3(aPacked.x & 0x7Fu, (aPacked.x >> 14) & 0x1FFFu, (aPacked.x >> 7) & 0x7Fu);
+    gl_Position = projection * view * vec4(vec3(aChunkOrigin) + localPos, 1.0);
 
-    blockY = aY;
+    blockY = localPos.y;
 }
@@ -1,15 +1,22 @@
 #version 330 core
 
 in vec2 TexCoord;
+flat in int Tile;
+in float Light;
 in vec3 Normal;
 in vec3 FragPos;
 
 out vec4 FragColor;
 
-uniform sampler2D atlas;
-uniform vec3 lightDir;
-uniform vec3 lightColor;
-uniform vec3 ambientColor;
+uniform sampler2DArray atlas; // one layer per tile, see App::loadTextureArray
+// Per frame, shared by all programs (FrameUniforms::Block)
+layout (std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    vec4 lightDir;
+    vec4 lightColor;
+    vec4 ambientColor;
+};
 
 float near = 0.1;
 float far  = 100.0;
@@ -21,12 +28,13 @@ float LinearizeDepth(float depth)
 }
 
 void main() {
-    vec4 texColor = texture(atlas, TexCoord);
+    // The layer repeats across merged faces with GL_REPEAT
+    vec4 texColor = texture(atlas, vec3(TexCoord, Tile));
 
     vec3 norm = normalize(Normal);
-    float diff = max(dot(norm, -lightDir), 0.0);
+    float diff = max(dot(norm, -lightDir.xyz), 0.0);
 
-    vec3 lighting = texColor.rgb * (ambientColor + lightColor * diff);
+    vec3 lighting = texColor.rgb * (ambientColor.rgb + lightColor.rgb * diff) * Light;
 
     //FragColor = texColor;
     FragColor = vec4(lighting, texColor.a); // Lighting
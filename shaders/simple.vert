@@ -1,19 +1,45 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoord;
-layout (location = 3) in vec3 aNormal;
+// Packed chunk vertex, layout documented next to Chunk::VERTEX_WORDS
+layout (location = 0) in uvec2 aPacked;
+// World block origin of the chunk, one per draw (see ChunkRenderer)
+layout (location = 1) in ivec3 aChunkOrigin;
 
-out vec2 TexCoord;
+out vec2 TexCoord; // in blocks, repeats across merged quads
+flat out int Tile; // texture layer
+out float Light;
 out vec3 Normal;
 out vec3 FragPos;
 
-uniform mat4 view;
-uniform mat4 projection;
+// Per frame, shared by all programs (FrameUniforms::Block)
+layout (std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    vec4 lightDir;
+    vec4 lightColor;
+    vec4 ambientColor;
+};
+
+// Per face: normal and the axes the texture u/v run along, so a merged quad
+// repeats the tile once per block
+const vec3 FACE_NORMALS[6] = vec3[6](
+    vec3(0, 0, 1), vec3(0, 0, -1), vec3(0, 1, 0), vec3(0, -1, 0), vec3(1, 0, 0), vec3(-1, 0, 0));
+const vec3 FACE_U[6] = vec3[6](
+    vec3(1, 0, 0), vec3(-1, 0, 0), vec3(1, 0, 0), vec3(1, 0, 0), vec3(0, 0, -1), vec3(0, 0, 1));
+const vec3 FACE_V[6] = vec3[6](
+    vec3(0, 1, 0), vec3(0, 1, 0), vec3(0, 0, -1), vec3(0, 0, 1), vec3(0, 1, 0), vec3(0, 1, 0));
 
 void main()  {
-    FragPos = aPos;
-    Normal = aNormal;
-    TexCoord = aTexCoord;
+    vec3 localPos = vec3(aPacked.x & 0x7Fu, (aPacked.x >> 14) & 0x1FFFu, (aPacked.x >> 7) & 0x7Fu);
+    int face = int((aPacked.x >> 27) & 0x7u);
+
+    float light = float((aPacked.y >> 8) & 0xFu) / 15.0;
+    float ao = float((aPacked.y >> 12) & 0x3u) / 3.0;
+
+    FragPos = vec3(aChunkOrigin) + localPos;
+    Normal = FACE_NORMALS[face];
+    TexCoord = vec2(dot(localPos, FACE_U[face]), dot(localPos, FACE_V[face]));
+    Tile = int(aPacked.y & 0xFFu);
+    Light = light * mix(0.5, 1.0, ao);
 
-    gl_Position = projection * view * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -1,8 +1,14 @@
 #version 330 core
 layout(location = 0) in vec3 aPos;
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Per frame, shared by all programs (FrameUniforms::Block)
+layout (std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    vec4 lightDir;
+    vec4 lightColor;
+    vec4 ambientColor;
+};
 void main() {
     gl_Position = projection * view * model * vec4(aPos, 1.0);
 }
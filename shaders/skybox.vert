@@ -2,11 +2,17 @@
 layout (location = 0) in vec3 aPos;
 out vec3 TexCoord;
 
-uniform mat4 view;
-uniform mat4 projection;
+// Per frame, shared by all programs (FrameUniforms::Block)
+layout (std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    vec4 lightDir;
+    vec4 lightColor;
+    vec4 ambientColor;
+};
 
 void main() {
-    vec4 pos = projection * view * vec4(aPos, 1.0);
+    vec4 pos = projection * mat4(mat3(view)) * vec4(aPos, 1.0); // without the camera translation
     gl_Position = pos.xyww;
     TexCoord = aPos;
 }
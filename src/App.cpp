@@ -84,6 +84,7 @@ void App::init() {
 
 	if (seed.has_value()) world = std::make_unique<World>(seed.value());
     else world = std::make_unique<World>();
+    world->startUpdateThread();
     
     glEnable(GL_DEPTH_TEST);
     
@@ -141,7 +142,10 @@ void App::loadResources() {
 
     textureShader = std::make_shared<Shader>("shaders/simple.vert", "shaders/simple.frag");
     gradientShader = std::make_shared<Shader>("shaders/gradient.vert", "shaders/gradient.frag");
-    texture = loadTexture("assets/textures/textures.png");
+    texture = loadTextureArray("assets/textures/textures.png", Chunk::ATLAS_COLS, Chunk::ATLAS_ROWS);
+
+    gradientShader->use();
+    gradientShader->setInt("worldHeight", Chunk::HEIGHT);
 
     activeShader = textureShader;
 
@@ -192,7 +196,7 @@ void App::render() {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
         activeShader->use();
 
         // window aspect ratio
@@ -203,21 +207,17 @@ void App::render() {
         glm::mat4 view = camera->getViewMatrix();
         glm::mat4 projection = glm::perspective(glm::radians(80.0f), aspect, 0.1f, renderDistance);
 
-        // Set the uniform matrices in the shader
-        activeShader->setMat4("view", view);
-        activeShader->setMat4("projection", projection);
-
-        // Update lighting uniforms from the adjustable state.  Normalize the
-        // direction so that it remains a unit vector after editing.
-        glm::vec3 dirNorm = glm::normalize(lightDir);
-        activeShader->setVec3("lightDir", dirNorm);
-        activeShader->setVec3("lightColor", lightColor);
-        activeShader->setVec3("ambientColor", ambientColor);
+        // Matrices and lighting for every program of the frame, in one
+        // upload.  Normalize the direction so that it remains a unit vector
+        // after editing.
+        frameUniforms.update(view, projection, glm::normalize(lightDir), lightColor, ambientColor);
 
-        world->updateVisibleChunks(camera->Position, camera->Front);
-        world->render(activeShader);
-        skybox->draw(camera->getViewMatrix(), projection);
-        camera->drawWireframeSelectedBlockFace(world, view, projection);
+        // The world updates on its own thread from the view posted here, the
+        // frame only draws the last chunk list it published
+        world->setView(camera->Position, camera->Front);
+        world->render(activeShader, camera->Position, projection * view);
+        skybox->draw();
+        camera->drawWireframeSelectedBlockFace(world);
 
         if (showDebugWindow) {
             //ImGui::ShowDemoWindow();
@@ -260,6 +260,8 @@ void App::debugWindow() {
             ImGui::Text("FPS: %.1f (%.3f ms)", uiDisplayFPS, uiDisplayFPS > 0.0f ? 1000.0f / uiDisplayFPS : 0.0f);
             // Display camera coordinates
             ImGui::Text("Camera Position: x=%d y=%d z=%d", wx, wy, wz);
+            if (const std::optional<int> surface = world->getCameraSurfaceHeight())
+                ImGui::Text("Surface Height: %d", *surface);
 
             ImGui::Text("World SEED: %i", params.seed);
 
@@ -287,6 +289,31 @@ void App::debugWindow() {
                 const size_t visibleChunks = world->getRenderedChunkCount();
                 const size_t totalChunks   = world->getTotalChunkCount();
                 ImGui::Text("Chunks: %zu visible / %zu total", visibleChunks, totalChunks);
+                ImGui::Text("Cold chunks: %zu (%.2f MB compressed)", world->getCompressedChunkCount(),
+                            world->getCompressedBytes() / (1024.0 * 1024.0));
+                const std::size_t meshVertices = world->getRenderedVertexCount();
+                ImGui::Text("Mesh vertices: %zu (%.2f MB)", meshVertices,
+                            meshVertices * Chunk::VERTEX_WORDS * sizeof(uint32_t) / (1024.0 * 1024.0));
+                ImGui::Text("Edit to visible: %.2f ms", world->getEditLatencyMs());
+                ImGui::Text("Mesh cache: %zu meshes (%.2f MB), %zu reused", world->getMeshCache().getEntryCount(),
+                            world->getMeshCache().getBytes() / (1024.0 * 1024.0), world->getReusedMeshCount());
+                const ChunkCuller &culler = world->getCuller();
+                ImGui::Text("Culling: %zu drawn, %zu outside the frustum, %zu in caves, %zu under the horizon, "
+                            "%zu occluded", culler.getVisibleCount(), culler.getCulledCount(),
+                            culler.getCaveHiddenCount(), culler.getHorizonHiddenCount(),
+                            culler.getOcclusionHiddenCount());
+                ImGui::Text("Occlusion job: %.3f ms, %.1f%% of tested chunks hidden", culler.getOcclusionMs(),
+                            culler.getOcclusionHitRate() * 100.0f);
+                const ChunkRenderer &renderer = world->getRenderer();
+                ImGui::Text("Draws: %zu calls, %zu commands (%s), %.2f / %.2f MB", renderer.getDrawCallCount(),
+                            renderer.getDrawCommandCount(), renderer.usesIndirectDraws() ? "indirect" : "per chunk",
+                            renderer.getUsedBytes() / (1024.0 * 1024.0), renderer.getBufferBytes() / (1024.0 * 1024.0));
+                ImGui::Text("Buffer pool: %.2f MB in size classes, %.1f%% of ranges reused",
+                            renderer.getPooledBytes() / (1024.0 * 1024.0), renderer.getPoolHitRate() * 100.0f);
+                const UploadScheduler &uploads = world->getUploadScheduler();
+                ImGui::Text("Uploads: %.2f MB/frame, %zu chunks in %.2f ms, %zu queued",
+                            uploads.getUploadedBytes() / (1024.0 * 1024.0), uploads.getUploadedChunks(),
+                            uploads.getUploadMs(), uploads.getQueueDepth());
             }
             // Display memory usage in megabytes.  We call a static helper to
             // obtain the current resident set size (RSS).
@@ -387,6 +414,12 @@ void App::debugWindow() {
             if (ImGui::Checkbox("Wireframe", &wireframe)) {
                 glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL);
             }
+            // Mesher selection, every rendered chunk is remeshed with the new mode
+            const char *meshingModes[] = { "Naive", "Greedy", "Binary" };
+            int meshingMode = static_cast<int>(Chunk::getMeshingMode());
+            if (world && ImGui::Combo("Meshing", &meshingMode, meshingModes, IM_ARRAYSIZE(meshingModes))) {
+                world->setMeshingMode(static_cast<MeshingMode>(meshingMode));
+            }
             // Shader toggle (texture vs gradient).  We update activeShader accordingly.
             if (ImGui::Checkbox("Use Gradient Shader", &useGradientShader)) {
                 activeShader = useGradientShader ? gradientShader : textureShader;
@@ -398,9 +431,25 @@ void App::debugWindow() {
             // reasonable minimum and maximum.
             if (world) {
                 int radius = static_cast<int>(world->getLoadRadius());
-                if (ImGui::SliderInt("Chunk Load Radius", &radius, 4, 32)) {
+                if (ImGui::SliderInt("Chunk Load Radius", &radius, 4, 64)) {
                     world->setLoadRadius(radius);
                 }
+                bool lod = world->isLodEnabled();
+                if (ImGui::Checkbox("Level of detail", &lod)) {
+                    world->setLodEnabled(lod);
+                }
+                bool caveCulling = world->isCaveCullingEnabled();
+                if (ImGui::Checkbox("Cave culling", &caveCulling)) {
+                    world->setCaveCullingEnabled(caveCulling);
+                }
+                bool horizonCulling = world->isHorizonCullingEnabled();
+                if (ImGui::Checkbox("Horizon culling", &horizonCulling)) {
+                    world->setHorizonCullingEnabled(horizonCulling);
+                }
+                bool occlusionCulling = world->isOcclusionCullingEnabled();
+                if (ImGui::Checkbox("Occlusion culling", &occlusionCulling)) {
+                    world->setOcclusionCullingEnabled(occlusionCulling);
+                }
             }
 
             // Adjust the maximum number of chunks being generated at the same time.
@@ -449,6 +498,8 @@ void App::cleanup() {
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
     glDeleteTextures(1, &texture);
+    world->releaseGL();
+    frameUniforms.releaseGL();
 
     glfwTerminate();
     saveControls();
@@ -519,11 +570,7 @@ void App::processInput() {
 	//reload chunk. F3 + A;
 	if (glfwGetKey(window, GLFW_KEY_F3) == GLFW_PRESS &&
     	glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-		for (auto &chunkPtr : world->getRenderedChunks())
-		{
-			if (auto chunk = chunkPtr.lock())
-				chunk->buildMesh();
-		}
+		world->rebuildRenderedMeshes();
 		return;
 	}
 
@@ -687,29 +734,49 @@ void App::toggleDisplayMode() {
     }
 }
 
-unsigned int App::loadTexture(const char* path) {
+// Splits a cols x rows tile atlas into the layers of a texture array, layer
+// col + row * cols for the tile at (col, row) from the bottom left.  Each
+// layer gets its own mip chain, so distant faces sample small mips without
+// bleeding into the neighbouring tiles, and merged faces can repeat their
+// tile with GL_REPEAT.
+unsigned int App::loadTextureArray(const char* path, const int cols, const int rows) {
     GLuint texID;
     glGenTextures(1, &texID);
-    glBindTexture(GL_TEXTURE_2D, texID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texID);
 
     int w, h, ch;
     stbi_set_flip_vertically_on_load(true);
-    unsigned char* data = stbi_load(path, &w, &h, &ch, 0);
-    if (data) {
-        const GLenum format = ch == 4 ? GL_RGBA : GL_RGB;
-        glTexImage2D(GL_TEXTURE_2D, 0, format, w, h, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+    unsigned char* data = stbi_load(path, &w, &h, &ch, 4);
+    if (data && w % cols == 0 && h % rows == 0) {
+        const int tileWidth = w / cols;
+        const int tileHeight = h / rows;
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, tileWidth, tileHeight, cols * rows, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, nullptr);
+        // Read each tile straight out of the atlas rows
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, w);
+        for (int layer = 0; layer < cols * rows; ++layer) {
+            glPixelStorei(GL_UNPACK_SKIP_PIXELS, (layer % cols) * tileWidth);
+            glPixelStorei(GL_UNPACK_SKIP_ROWS, (layer / cols) * tileHeight);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, tileWidth, tileHeight, 1, GL_RGBA,
+                            GL_UNSIGNED_BYTE, data);
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+        glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
     } else {
-        std::cerr << "Failed to load texture: " << path << "\n";
+        std::cerr << "Failed to load texture atlas: " << path << "\n";
     }
-    
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
     stbi_image_free(data);
-    
+
     return texID;
 }
 
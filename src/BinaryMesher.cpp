@@ -0,0 +1,229 @@
+#include "BinaryMesher.hpp"
+#include "Chunk.hpp"
+
+#if defined(_MSC_VER)
+# include <intrin.h>
+#endif
+
+namespace {
+constexpr int W = Chunk::WIDTH;
+constexpr int D = Chunk::DEPTH;
+constexpr int STRIDE = D + 2; // rows per y, north/south padding included
+constexpr uint64_t ROW_MASK = W == 64 ? ~0ull : (1ull << W) - 1;
+
+inline int countTrailingZeros(const uint64_t value) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return static_cast<int>(index);
+#else
+	return __builtin_ctzll(value);
+#endif
+}
+
+static_assert(BLOCK_TYPE_COUNT <= 32, "BinaryMesher tracks block types in a 32-bit mask");
+
+inline std::size_t classOf(const BlockType type) {
+	return isOpaque(type) ? 0 : static_cast<std::size_t>(type);
+}
+}
+
+void BinaryMesher::build(const ChunkSnapshot &snapshot, std::vector<MeshQuad> &out) {
+	if (snapshot.isEmpty())
+		return;
+	minY = snapshot.getMinY();
+	rowCount = snapshot.getMaxY() - minY + 1;
+
+	buildMasks(snapshot);
+
+	const int planeRows = std::max(rowCount, D);
+	for (auto &plane : planes)
+		plane.assign(planeRows, 0);
+
+	for (int face = 0; face < 6; ++face) {
+		computeVisible(face);
+
+		// Slices along the face normal.  Planes are laid out with bits along
+		// the face u axis and rows along its v axis.
+		const bool yFace = face == 2 || face == 3;
+		const bool xFace = face == 4 || face == 5;
+		const int sliceCount = yFace ? rowCount : (xFace ? W : D);
+		const int rows = yFace ? D : rowCount;
+
+		for (int slice = 0; slice < sliceCount; ++slice) {
+			if (slice == Chunk::borderSlice(face))
+				continue; // border strip, built by Chunk::buildBorderStrip
+			uint32_t touched = 0; // block types with bits in this slice
+
+			for (std::size_t c = 0; c < classes.size(); ++c) {
+				if (!classes[c].used)
+					continue;
+				const std::vector<uint64_t> &vis = visible[c];
+
+				for (int v = 0; v < rows; ++v) {
+					uint64_t bits = vis[slice * rows + v];
+					if (!bits)
+						continue;
+
+					if (c != 0) {
+						planes[c][v] |= bits;
+						touched |= 1u << c;
+						continue;
+					}
+					// Opaque blocks share one mask, sort them by type
+					while (bits) {
+						const int u = countTrailingZeros(bits);
+						bits &= bits - 1;
+						int x, y, z;
+						if (yFace)      { x = u;     y = minY + slice; z = v; }
+						else if (xFace) { x = slice; y = minY + v;     z = u; }
+						else            { x = u;     y = minY + v;     z = slice; }
+						const auto type = static_cast<std::size_t>(snapshot.at(x, y, z));
+						planes[type][v] |= 1ull << u;
+						touched |= 1u << type;
+					}
+				}
+			}
+
+			for (std::size_t type = 0; touched; ++type, touched >>= 1) {
+				if (touched & 1u)
+					mergePlane(planes[type], rows, face, slice, static_cast<BlockType>(type), out);
+			}
+		}
+	}
+}
+
+void BinaryMesher::buildMasks(const ChunkSnapshot &snapshot) {
+	for (auto &masks : classes)
+		masks.used = false;
+
+	auto prepare = [this](ClassMasks &masks) {
+		masks.used = true;
+		masks.rows.assign(static_cast<std::size_t>(rowCount) * STRIDE, 0);
+		masks.east.assign(rowCount, 0);
+		masks.west.assign(rowCount, 0);
+	};
+	auto use = [&](const BlockType type) -> ClassMasks * {
+		if (type == BlockType::AIR)
+			return nullptr;
+		ClassMasks &masks = classes[classOf(type)];
+		if (!masks.used)
+			prepare(masks);
+		return &masks;
+	};
+	prepare(classes[0]); // the opaque class is read by every other class
+
+	for (int r = 0; r < rowCount; ++r) {
+		const int y = minY + r;
+		// z = -1 and z = DEPTH are the south/north border rows
+		for (int z = -1; z <= D; ++z) {
+			const BlockType *row = snapshot.row(y, z) + 1; // row[x], x in [-1, W]
+			for (int x = 0; x < W; ++x) {
+				if (ClassMasks *masks = use(row[x]))
+					masks->rows[r * STRIDE + z + 1] |= 1ull << x;
+			}
+			if (z < 0 || z == D)
+				continue;
+			if (ClassMasks *masks = use(row[W]))
+				masks->east[r] |= 1ull << z;
+			if (ClassMasks *masks = use(row[-1]))
+				masks->west[r] |= 1ull << z;
+		}
+	}
+}
+
+// visible[c] = faces of class c not hidden by an opaque block or, for
+// transparent types, by a block of the same type.  Stored as planes, one row
+// per v of each slice along the normal: Y faces are (y, z) rows of x bits,
+// Z faces (z, y) rows of x bits and X faces (x, y) rows of z bits, the latter
+// transposed by scattering the visible bits only.
+void BinaryMesher::computeVisible(const int face) {
+	const ClassMasks &opaque = classes[0];
+
+	for (std::size_t c = 0; c < classes.size(); ++c) {
+		const ClassMasks &src = classes[c];
+		if (!src.used)
+			continue;
+		const bool selfOccludes = c != 0 && getBlockInfo(static_cast<BlockType>(c)).transparent;
+		auto occluders = [&](const std::vector<uint64_t> &opaqueBits, const std::vector<uint64_t> &selfBits, std::size_t i) {
+			return selfOccludes ? opaqueBits[i] | selfBits[i] : opaqueBits[i];
+		};
+
+		std::vector<uint64_t> &vis = visible[c];
+		const bool xFace = face == 4 || face == 5;
+		vis.assign(static_cast<std::size_t>(rowCount) * (xFace ? W : D), 0);
+
+		for (int r = 0; r < rowCount; ++r) {
+			for (int z = 0; z < D; ++z) {
+				const std::size_t i = r * STRIDE + z + 1;
+				uint64_t hidden;
+				switch (face) {
+				case 0: // +Z
+					hidden = occluders(opaque.rows, src.rows, i + 1);
+					break;
+				case 1: // -Z
+					hidden = occluders(opaque.rows, src.rows, i - 1);
+					break;
+				case 2: // +Y, air above the occupied range
+					hidden = r + 1 < rowCount ? occluders(opaque.rows, src.rows, i + STRIDE) : 0;
+					break;
+				case 3: // -Y
+					hidden = r > 0 ? occluders(opaque.rows, src.rows, i - STRIDE) : 0;
+					break;
+				case 4: // +X, the last bit is hidden by the east border column
+					hidden = (occluders(opaque.rows, src.rows, i) >> 1)
+					       | (((occluders(opaque.east, src.east, r) >> z) & 1ull) << (W - 1));
+					break;
+				default: // -X
+					hidden = ((occluders(opaque.rows, src.rows, i) << 1) & ROW_MASK)
+					       | ((occluders(opaque.west, src.west, r) >> z) & 1ull);
+					break;
+				}
+				uint64_t bits = src.rows[i] & ~hidden;
+				if (face == 2 || face == 3)
+					vis[r * D + z] = bits;
+				else if (!xFace)
+					vis[z * rowCount + r] = bits;
+				else {
+					for (; bits; bits &= bits - 1)
+						vis[countTrailingZeros(bits) * rowCount + r] |= 1ull << z;
+				}
+			}
+		}
+	}
+}
+
+// Greedy merge on bits: take the lowest run of ones of a row, then extend it
+// over the following rows while they contain the whole run.  Merged bits are
+// cleared, so the plane is all zero again on return.
+void BinaryMesher::mergePlane(std::vector<uint64_t> &plane, const int rows, const int face, const int slice,
+                              const BlockType type, std::vector<MeshQuad> &out) const {
+	const bool yFace = face == 2 || face == 3;
+	const bool xFace = face == 4 || face == 5;
+
+	for (int v = 0; v < rows; ++v) {
+		while (plane[v]) {
+			const int u = countTrailingZeros(plane[v]);
+			const uint64_t run = plane[v] >> u;
+			const int width = ~run == 0 ? 64 - u : countTrailingZeros(~run);
+			const uint64_t mask = (width == 64 ? ~0ull : (1ull << width) - 1) << u;
+
+			int height = 1;
+			while (v + height < rows && (plane[v + height] & mask) == mask) {
+				plane[v + height] &= ~mask;
+				++height;
+			}
+			plane[v] &= ~mask;
+
+			MeshQuad quad;
+			if (yFace)      { quad.x = u;     quad.y = minY + slice; quad.z = v; }
+			else if (xFace) { quad.x = slice; quad.y = minY + v;     quad.z = u; }
+			else            { quad.x = u;     quad.y = minY + v;     quad.z = slice; }
+			quad.face = static_cast<uint8_t>(face);
+			quad.sizeU = static_cast<uint16_t>(width);
+			quad.sizeV = static_cast<uint16_t>(height);
+			quad.type = type;
+			out.push_back(quad);
+		}
+	}
+}
@@ -75,25 +75,17 @@ void BitPackedArray::decodeAll(std::vector<uint32_t>& out) const {
     }
 }
 
-void BitPackedArray::encodeAll(
-    const std::vector<BlockType>& blocks,
-    std::vector<BlockType>& palette,
-    std::unordered_map<BlockType, uint32_t>& paletteMap)
+void BitPackedArray::encodeAll(const std::vector<BlockType>& blocks, BlockPalette& palette)
 {
     if (blocks.size() != m_size) {
         throw std::invalid_argument("encodeAll: input vector size does not match array size");
     }
 
     palette.clear();
-    paletteMap.clear();
 
     // Build palette
     for (const auto& block : blocks) {
-        if (paletteMap.find(block) == paletteMap.end()) {
-            uint32_t index = static_cast<uint32_t>(palette.size());
-            palette.push_back(block);
-            paletteMap[block] = index;
-        }
+        palette.indexOf(block);
     }
 
     // Compute required bits
@@ -112,7 +104,7 @@ void BitPackedArray::encodeAll(
     uint32_t mask = (1u << m_bitsPerEntry) - 1;
 
     for (size_t i = 0; i < blocks.size(); ++i) {
-        uint32_t value = paletteMap[blocks[i]] & mask;
+        uint32_t value = palette.indices[static_cast<uint8_t>(blocks[i])] & mask;
 
         size_t wordIndex = bitPos >> 5;
         size_t bitOffset = bitPos & 31;
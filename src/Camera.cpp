@@ -64,56 +64,12 @@ void Camera::updateCameraVectors() {
     Up    = glm::normalize(glm::cross(Right, Front));
 }
 
-bool Camera::getTargetedBlock(std::unique_ptr<World> &world, glm::ivec3& hitBlock, glm::ivec3& faceNormal, float maxDistance) {
-    glm::vec3 rayOrigin = Position;
-    glm::vec3 rayDir = glm::normalize(Front);
-
-    glm::ivec3 blockPos = glm::floor(rayOrigin);
-
-    glm::vec3 deltaDist = glm::abs(glm::vec3(1.0f) / rayDir);
-    glm::ivec3 step;
-    glm::vec3 sideDist;
-
-    for (int i = 0; i < 3; ++i) {
-        if (rayDir[i] < 0) {
-            step[i] = -1;
-            sideDist[i] = (rayOrigin[i] - blockPos[i]) * deltaDist[i];
-        } else {
-            step[i] = 1;
-            sideDist[i] = (blockPos[i] + 1.0f - rayOrigin[i]) * deltaDist[i];
-        }
-    }
-
-    float distanceTraveled = 0.0f;
-    glm::ivec3 prevBlock = blockPos;
-
-    while (distanceTraveled < maxDistance) {
-        int axis;
-        if (sideDist.x < sideDist.y) {
-            if (sideDist.x < sideDist.z) axis = 0;
-            else                         axis = 2;
-        } else {
-            if (sideDist.y < sideDist.z) axis = 1;
-            else                         axis = 2;
-        }
-
-        blockPos[axis] += step[axis];
-        sideDist[axis] += deltaDist[axis];
-
-        // Track face direction
-        faceNormal = glm::ivec3(0);
-        faceNormal[axis] = -step[axis];
-
-		distanceTraveled = glm::min(glm::min(sideDist.x, sideDist.y), sideDist.z);
-
-        // Check if this block exists in your world
-        if (world && world->isBlockVisibleWorld(blockPos)) {
-            hitBlock = blockPos;
-            return true;
-        }
-    }
-
-    return false;
+bool Camera::getTargetedBlock(std::unique_ptr<World> &world, glm::ivec3& hitBlock, glm::ivec3& faceNormal) {
+    if (!world || !world->getTargetedBlock())
+        return false;
+    hitBlock = world->getTargetedBlock()->block;
+    faceNormal = world->getTargetedBlock()->faceNormal;
+    return true;
 }
 
 void Camera::removeTargettedBlock(std::unique_ptr<World> &world)
@@ -168,9 +124,10 @@ void Camera::initWireframeCube() {
     glBindVertexArray(0); // Unbind VAO
 
 	blockWireframeShader = std::make_unique<Shader>("shaders/simpleWireframe.vert", "shaders/simpleWireframe.frag");
+	wireframeModelLocation = blockWireframeShader->getUniformLocation("model");
 }
 
-void Camera::drawWireframeSelectedBlockFace(std::unique_ptr<World> &world, glm::mat4 &view, glm::mat4 &projection) {
+void Camera::drawWireframeSelectedBlockFace(std::unique_ptr<World> &world) {
 
 	glm::ivec3 blockPos, faceNormal;
 	if (!getTargetedBlock(world, blockPos, faceNormal))
@@ -179,9 +136,7 @@ void Camera::drawWireframeSelectedBlockFace(std::unique_ptr<World> &world, glm::
 	glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(blockPos));
 
 	blockWireframeShader->use();
-	blockWireframeShader->setMat4("model", model);
-	blockWireframeShader->setMat4("view", view);
-	blockWireframeShader->setMat4("projection", projection);
+	blockWireframeShader->setMat4(wireframeModelLocation, model);
 
     glBindVertexArray(wireframeVAO);
     glDrawElements(GL_LINES, 24, GL_UNSIGNED_INT, nullptr);
@@ -1,57 +1,12 @@
 #include "Chunk.hpp"
 #include "World.hpp"
+#include "MeshArena.hpp"
 
-// This function maps block type + face to UV offset
-glm::vec2 getTextureOffset(const BlockType type, const int face) {
-    int col = 0;
-    int row = 0;
-
-    switch (type) {
-        case BlockType::GRASS:
-            if (face == 2)      { col = 0; row = 0; } // top
-            else if (face == 3) { col = 2; row = 0; } // bottom = dirt
-            else                { col = 1; row = 0; } // side = grass-side
-            break;
-
-        case BlockType::DIRT:
-            col = 2; row = 0;
-            break;
-
-        case BlockType::STONE:
-            col = 3; row = 0;
-            break;
-
-        case BlockType::SAND:
-            col = 4; row = 0;
-            break;
-
-        case BlockType::SNOW:
-            col = 5; row = 0;
-            break;
-
-        case BlockType::WATER:
-            col = 6; row = 0;
-            break;
-            
-        case BlockType::BEDROCK:
-            col = 7; row = 0;
-            break;
-
-        case BlockType::LOG:
-            col = 8; row = 0;
-            break;
-        case BlockType::LEAVES:
-            col = 9; row = 0;
-            break;
-
-        default:
-            col = 0; row = 0;
-            std::cerr << "Unknown BlockType in getTextureOffset: " << static_cast<int>(type) << std::endl;
-            break;
-    }
-
-    return glm::vec2(col, row);
-}
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <sstream>
+#include <zlib.h>
 
 // Save a simple RGB PPM where each pixel is an sRGB color representing the biome
 static void saveBiomePPM(const std::string &path, const std::vector<glm::u8vec3> &img, int w, int h) {
@@ -68,19 +23,21 @@ static void saveBiomePPM(const std::string &path, const std::vector<glm::u8vec3>
     f.close();
 }
 
-Chunk::Chunk(const int chunkX, const int chunkZ, const TerrainGenerationParams& params, const bool doGenerate)
-    : originX(chunkX * WIDTH), originZ(chunkZ * DEPTH),
-      blockIndices(WIDTH * HEIGHT * DEPTH, /*bitsPerEntry=*/4), currentParams(params)  // or more, depending on palette size. We could even use 3 as we use less than 8 types of blocks
+Chunk::Chunk(const int chunkX, const int chunkZ, TerrainParamsHandle params, const bool doGenerate)
+    : blockIndices(WIDTH * HEIGHT * DEPTH, /*bitsPerEntry=*/4),  // or more, depending on palette size. We could even use 3 as we use less than 8 types of blocks
+      originX(chunkX * WIDTH), originZ(chunkZ * DEPTH),
+      cold(std::make_unique<ChunkColdData>())
 {
+	cold->params = std::move(params);
 	if (doGenerate)
-    	generate(params);
+    	generate(*cold->params);
 	else preGenerated = true;
     	
 }
 
-Chunk::Chunk() : sourceChunkX(0), sourceChunkZ(0), originX(0), originZ(0),
-		  VAO(0), VBO(0), meshVerticesSize(0),
-		  blockIndices(WIDTH * HEIGHT * DEPTH, 0)
+Chunk::Chunk() : blockIndices(WIDTH * HEIGHT * DEPTH, 4), originX(0), originZ(0),
+		  meshVertexCount(0),
+		  cold(std::make_unique<ChunkColdData>())
 {
     adjacentChunks[0].reset();
     adjacentChunks[1].reset();
@@ -89,25 +46,25 @@ Chunk::Chunk() : sourceChunkX(0), sourceChunkZ(0), originX(0), originZ(0),
 }
 
 Chunk::~Chunk() {
-    if (glfwGetCurrentContext()) {
-        if (VAO) {
-            glDeleteVertexArrays(1, &VAO);
-            VAO = 0;
-        }
-        if (VBO) {
-            glDeleteBuffers(1, &VBO);
-            VBO = 0;
-        }
-    } else {
-        VAO = 0;
-        VBO = 0;
-    }
+    releaseGL();
+}
+
+// No GL call, the range only goes back to the renderer free list
+void Chunk::releaseGL() {
+    if (meshRenderer)
+        meshRenderer->release(meshAllocation);
+    meshVertexCount = 0;
+    meshMinY = 0;
+    meshMaxY = -1;
+    cold->uploadedMesh = ChunkMeshData();
 }
 
 
 bool Chunk::hasAllAdjacentChunkLoaded() const {
     for (const auto& adj : adjacentChunks) {
-        if (adj.expired()) {
+        auto neighbor = adj.lock();
+        // A cold neighbour has no voxels to read its border from
+        if (!neighbor || neighbor->isCompressed()) {
             return false;
         }
     }
@@ -276,8 +233,11 @@ BiomeType Chunk::computeBiome(const TerrainGenerationParams& terrainParams, floa
     Noise tempNoise(terrainParams.seed + 45);
     Noise humidNoise(terrainParams.seed + 964);
 
+    // biomeScaleChunks counts 16 block chunks so biomes keep their size
+    // whatever FT_VOX_CHUNK_SIZE is
+    constexpr float biomeChunkWidth = 16.0f;
     const float chunks = glm::max(1, terrainParams.biomeScaleChunks);
-    const float worldUnitsPerPatch = chunks * Chunk::WIDTH * 8.0f;
+    const float worldUnitsPerPatch = chunks * biomeChunkWidth * 8.0f;
     const float freqCoarse = 1.0f / glm::max(256.0f, worldUnitsPerPatch);
 
     // Coarse climate fields in [0..1]
@@ -482,7 +442,46 @@ void Chunk::generate(const TerrainGenerationParams& terrainParams) {
     generateCaves(blocks, terrainParams);
 
     // encode palette and block data (same as before)
-    blockIndices.encodeAll(blocks.getData(), palette, paletteMap);
+    blockIndices.encodeAll(blocks.getData(), palette);
+    rebuildHeightMap(blocks.getData());
+}
+
+void Chunk::rebuildHeightMap(const std::vector<BlockType> &blocks) {
+    minBlockY = HEIGHT;
+    maxBlockY = -1;
+    for (int z = 0; z < DEPTH; ++z) {
+        for (int x = 0; x < WIDTH; ++x) {
+            int top = -1;
+            for (int y = HEIGHT - 1; y >= 0; --y) {
+                if (blocks[x + WIDTH * (y + HEIGHT * z)] != BlockType::AIR) {
+                    top = y;
+                    break;
+                }
+            }
+            heightMap[x + WIDTH * z] = static_cast<int16_t>(top);
+            if (top < 0)
+                continue;
+            maxBlockY = std::max(maxBlockY, top);
+
+            for (int y = 0; y < minBlockY && y <= top; ++y) {
+                if (blocks[x + WIDTH * (y + HEIGHT * z)] != BlockType::AIR) {
+                    minBlockY = y;
+                    break;
+                }
+            }
+        }
+    }
+    if (maxBlockY < 0)
+        minBlockY = 0;
+}
+
+void Chunk::decodeBlocks(std::vector<BlockType> &out) const {
+    std::vector<uint32_t> decodedIndices;
+    blockIndices.decodeAll(decodedIndices);
+
+    out.resize(decodedIndices.size());
+    for (size_t i = 0; i < decodedIndices.size(); ++i)
+        out[i] = palette[decodedIndices[i]];
 }
 
 void Chunk::generateCaves(BlockStorage &blocks, const TerrainGenerationParams &terrainParams) {
@@ -511,6 +510,9 @@ BlockType Chunk::getBlock(int x, int y, int z) const {
     if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT || z < 0 || z >= DEPTH) {
         return BlockType::AIR; // Out of bounds returns air
     }
+    if (compressed) {
+        return BlockType::AIR; // Voxels are parked in the cold tier
+    }
 
     int index = x + WIDTH * (y + HEIGHT * z);
     uint32_t paletteIndex = blockIndices.get(index);
@@ -521,43 +523,41 @@ void Chunk::setBlock(int x, int y, int z, BlockType type) {
     if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT || z < 0 || z >= DEPTH) {
         return; // Out of bounds, do nothing
     }
-
-    int index = x + WIDTH * (y + HEIGHT * z);
-    auto it = paletteMap.find(type);
-	uint32_t paletteIndex;
-
-	if (it == paletteMap.end()) {
-        paletteIndex = static_cast<uint32_t>(palette.size());
-        palette.push_back(type);
-        paletteMap[type] = paletteIndex;
-    } else {
-    	paletteIndex = it->second;
+    if (compressed) {
+        return;
     }
 
-    blockIndices.set(index, paletteIndex);
-
-	buildMesh();
-
-	//update possible neighbour
-	if (x == 0) {
-		if (auto westChunk = adjacentChunks[WEST].lock()) {
-			westChunk->buildMesh();
-		}
-	}
-	if (x == WIDTH - 1) {
-		if (auto eastChunk = adjacentChunks[EAST].lock()) {
-			eastChunk->buildMesh();
-		}
-	}
-	if (z == 0) {
-		if (auto southChunk = adjacentChunks[SOUTH].lock()) {
-			southChunk->buildMesh();
+    int index = x + WIDTH * (y + HEIGHT * z);
+    blockIndices.set(index, palette.indexOf(type));
+	++editCount;
+
+	// Keep the column index in sync
+	int16_t &top = heightMap[x + WIDTH * z];
+	if (type != BlockType::AIR) {
+		top = std::max<int16_t>(top, static_cast<int16_t>(y));
+		minBlockY = maxBlockY < 0 ? y : std::min(minBlockY, y);
+		maxBlockY = std::max(maxBlockY, y);
+	} else {
+		if (y == top) {
+			int newTop = y - 1;
+			while (newTop >= 0 && getBlock(x, newTop, z) == BlockType::AIR)
+				--newTop;
+			top = static_cast<int16_t>(newTop);
+			maxBlockY = *std::max_element(heightMap.begin(), heightMap.end());
 		}
-	}
-	if (z == DEPTH - 1) {
-		if (auto northChunk = adjacentChunks[NORTH].lock()) {
-			northChunk->buildMesh();
+		if (y == minBlockY && maxBlockY >= 0) {
+			// Rare: the lowest layer lost a block, find the new lowest one
+			bool found = false;
+			for (int ly = minBlockY; ly <= maxBlockY && !found; ++ly) {
+				for (int lz = 0; lz < DEPTH && !found; ++lz)
+					for (int lx = 0; lx < WIDTH && !found; ++lx)
+						found = getBlock(lx, ly, lz) != BlockType::AIR;
+				if (found)
+					minBlockY = ly;
+			}
 		}
+		if (maxBlockY < 0)
+			minBlockY = 0;
 	}
 }
 
@@ -566,8 +566,8 @@ bool Chunk::isBlockVisible(glm::ivec3 pos) {
     if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT || z < 0 || z >= DEPTH)
         return false;
 
-    int idx = x + WIDTH * (y + HEIGHT * z);
-    if (getBlock(x,y,z) == BlockType::AIR)
+    const BlockType type = getBlock(x, y, z);
+    if (!isSolid(type))
         return false;
 
     auto getBlockOrNeighbor = [&](int dx, int dy, int dz, Direction dir) -> BlockType {
@@ -585,199 +585,898 @@ bool Chunk::isBlockVisible(glm::ivec3 pos) {
 		return getBlock(x + dx, y + dy, z + dz);
     };
 
-    return getBlockOrNeighbor(0, 0, +1, NORTH) == BlockType::AIR ||
-           getBlockOrNeighbor(0, 0, -1, SOUTH) == BlockType::AIR ||
-           y == HEIGHT - 1 || getBlockOrNeighbor(0, +1, 0, NONE) == BlockType::AIR ||
-           y == 0 || getBlockOrNeighbor(0, -1, 0, NONE) == BlockType::AIR ||
-           getBlockOrNeighbor(+1, 0, 0, EAST) == BlockType::AIR ||
-           getBlockOrNeighbor(-1, 0, 0, WEST) == BlockType::AIR;
+    return !isFaceOccluded(type, getBlockOrNeighbor(0, 0, +1, NORTH)) ||
+           !isFaceOccluded(type, getBlockOrNeighbor(0, 0, -1, SOUTH)) ||
+           y == HEIGHT - 1 || !isFaceOccluded(type, getBlockOrNeighbor(0, +1, 0, NONE)) ||
+           y == 0 || !isFaceOccluded(type, getBlockOrNeighbor(0, -1, 0, NONE)) ||
+           !isFaceOccluded(type, getBlockOrNeighbor(+1, 0, 0, EAST)) ||
+           !isFaceOccluded(type, getBlockOrNeighbor(-1, 0, 0, WEST));
 }
 
 
-void Chunk::buildMesh() {
+void Chunk::buildMesh(ChunkRenderer &renderer) {
 	buildMeshData();
-	uploadMesh();
+	uploadMesh(renderer);
+}
+
+namespace {
+// Normal axis (0 = x, 1 = y, 2 = z) and in-plane axes of each face, in
+// writeQuad face order.  u/v follow the texture orientation of the face, so a
+// quad of sizeU x sizeV blocks repeats the tile sizeU x sizeV times.
+struct FaceAxes {
+	int normal;
+	int dx, dy, dz; // offset to the block that can hide the face
+	int u, v;
+};
+
+constexpr FaceAxes FACE_AXES[6] = {
+	{ 2,  0,  0, +1, 0, 1 }, // front (+Z)
+	{ 2,  0,  0, -1, 0, 1 }, // back (-Z)
+	{ 1,  0, +1,  0, 0, 2 }, // top (+Y)
+	{ 1,  0, -1,  0, 0, 2 }, // bottom (-Y)
+	{ 0, +1,  0,  0, 2, 1 }, // right (+X)
+	{ 0, -1,  0,  0, 2, 1 }, // left (-X)
+};
+
+inline MeshQuad makeQuad(int x, int y, int z, int face, int sizeU, int sizeV, BlockType type) {
+	MeshQuad quad;
+	quad.x = static_cast<int16_t>(x);
+	quad.y = static_cast<int16_t>(y);
+	quad.z = static_cast<int16_t>(z);
+	quad.face = static_cast<uint8_t>(face);
+	quad.sizeU = static_cast<uint16_t>(sizeU);
+	quad.sizeV = static_cast<uint16_t>(sizeV);
+	quad.type = type;
+	return quad;
+}
+
+// Face held by the border strip of each Direction, and the other way round
+constexpr int DIRECTION_FACE[4] = { 0, 1, 4, 5 };
+constexpr Direction FACE_DIRECTION[6] = { NORTH, SOUTH, NONE, NONE, EAST, WEST };
+
+// Section of the highest block a quad covers, Y runs along v on the side faces
+inline int quadTopSection(const MeshQuad &quad) {
+	const int height = FACE_AXES[quad.face].v == 1 ? quad.sizeV : 1;
+	return (quad.y + height - 1) / ChunkMeshData::SECTION_HEIGHT;
+}
+
+// Same from the four packed vertices of a quad: the corners of a face lie on
+// top of its blocks except for the bottom face
+inline int packedQuadTopSection(const uint32_t *vertices) {
+	uint32_t cornerY = 0;
+	for (int corner = 0; corner < 4; ++corner)
+		cornerY = std::max(cornerY, (vertices[corner * Chunk::VERTEX_WORDS] >> 14) & 0x1FFFu);
+	const uint32_t face = (vertices[0] >> 27) & 0x7u;
+	const int top = static_cast<int>(face == 3 ? cornerY : cornerY - 1);
+	return std::max(top, 0) / ChunkMeshData::SECTION_HEIGHT;
+}
+
+// Everything of a mesh but its parts
+void copyMeshLayout(const ChunkMeshData &from, ChunkMeshData &to) {
+	to.builtParts = from.builtParts;
+	to.interiorFaceQuads = from.interiorFaceQuads;
+	to.sectionConnectivity = from.sectionConnectivity;
+	to.occluders = from.occluders;
+	to.partHashes = from.partHashes;
+	to.minY = from.minY;
+	to.maxY = from.maxY;
+}
+
+// Level of detail: a cell of scale^3 blocks becomes one type, air unless most
+// of the cell is filled, else the type of its topmost block so that grass
+// stays on top.  Layers from cellTop up are outside the chunk.
+template <typename GetBlock>
+BlockType mergeCell(const int cx, const int cy, const int cz, const int scale, const int cellTop, GetBlock getBlock) {
+	int filled = 0;
+	int topY = -1;
+	BlockType top = BlockType::AIR;
+	for (int y = cy; y < cellTop; ++y) {
+		for (int z = cz; z < cz + scale; ++z) {
+			for (int x = cx; x < cx + scale; ++x) {
+				const BlockType type = getBlock(x, y, z);
+				if (type == BlockType::AIR)
+					continue;
+				++filled;
+				if (y > topY) {
+					topY = y;
+					top = type;
+				}
+			}
+		}
+	}
+	return filled * 2 >= scale * scale * scale ? top : BlockType::AIR;
+}
+
+std::atomic<MeshingMode> meshingMode{MeshingMode::BINARY};
+}
+
+void Chunk::setMeshingMode(const MeshingMode mode) {
+	meshingMode = mode;
+}
+
+MeshingMode Chunk::getMeshingMode() {
+	return meshingMode;
+}
+
+void Chunk::takeSnapshot(ChunkSnapshot &snapshot) const {
+	snapshot.heightMap = heightMap;
+	snapshot.minY = minBlockY;
+	snapshot.maxY = compressed ? minBlockY - 1 : maxBlockY;
+	snapshot.borders = 0;
+
+	// Whole cells along Y, the merged columns can end anywhere in them
+	const int scale = 1 << lod;
+	if (lod != 0 && !snapshot.isEmpty()) {
+		snapshot.minY = snapshot.minY / scale * scale;
+		snapshot.maxY = std::min(HEIGHT - 1, (snapshot.maxY / scale + 1) * scale - 1);
+		snapshot.heightMap.fill(static_cast<int16_t>(snapshot.maxY));
+	}
+
+	const int layers = snapshot.isEmpty() ? 0 : snapshot.maxY - snapshot.minY + 1;
+	snapshot.data.assign(static_cast<std::size_t>(ChunkSnapshot::PADDED_WIDTH) * ChunkSnapshot::PADDED_DEPTH * (layers + 2),
+	                     BlockType::AIR);
+	if (snapshot.isEmpty())
+		return;
+
+	// One buffer per thread taking snapshots (World's update thread, the
+	// tools), reused by every snapshot of that thread
+	static thread_local std::vector<uint32_t> decodedIndices;
+	blockIndices.decodeAll(decodedIndices);
+	for (int y = snapshot.minY; y <= snapshot.maxY; ++y)
+		for (int z = 0; z < DEPTH; ++z)
+			for (int x = 0; x < WIDTH; ++x)
+				snapshot.at(x, y, z) = palette[decodedIndices[x + WIDTH * (y + HEIGHT * z)]];
+	if (lod != 0)
+		mergeLodCells(snapshot, scale);
+
+	for (int dir = 0; dir < 4; ++dir)
+		copyBorder(snapshot, static_cast<Direction>(dir));
+}
+
+// Border blocks of dir, left as air when the neighbour is missing or cold.
+// Sides between chunks at different levels of detail do not line up, they
+// are closed by skirts: the border stays air so that every outward face of
+// the side is kept.  Chunks above level 0 also build a skirt where the
+// neighbour is missing, and read the merged cells of a neighbour at their
+// own level.
+void Chunk::copyBorder(ChunkSnapshot &snapshot, const Direction dir) const {
+	auto neighbor = adjacentChunks[dir].lock();
+	if (!neighbor || neighbor->isCompressed()) {
+		if (lod != 0)
+			snapshot.borders |= 1 << dir;
+		return;
+	}
+	snapshot.borders |= 1 << dir;
+	if (neighbor->lod != lod)
+		return;
+	if (lod != 0) {
+		copyLodBorder(snapshot, dir, *neighbor);
+		return;
+	}
+
+	for (int y = snapshot.minY; y <= snapshot.maxY; ++y) {
+		switch (dir) {
+		case NORTH:
+			for (int x = 0; x < WIDTH; ++x)
+				snapshot.at(x, y, DEPTH) = neighbor->getBlock(x, y, 0);
+			break;
+		case SOUTH:
+			for (int x = 0; x < WIDTH; ++x)
+				snapshot.at(x, y, -1) = neighbor->getBlock(x, y, DEPTH - 1);
+			break;
+		case EAST:
+			for (int z = 0; z < DEPTH; ++z)
+				snapshot.at(WIDTH, y, z) = neighbor->getBlock(0, y, z);
+			break;
+		default:
+			for (int z = 0; z < DEPTH; ++z)
+				snapshot.at(-1, y, z) = neighbor->getBlock(WIDTH - 1, y, z);
+			break;
+		}
+	}
+}
+
+// Cells are aligned on multiples of scale, see mergeCell
+void Chunk::mergeLodCells(ChunkSnapshot &snapshot, const int scale) {
+	auto getBlock = [&snapshot](int x, int y, int z) { return snapshot.at(x, y, z); };
+	for (int cy = snapshot.minY; cy <= snapshot.maxY; cy += scale) {
+		const int cellTop = std::min(cy + scale, snapshot.maxY + 1); // short cells at the top of the chunk
+		for (int cz = 0; cz < DEPTH; cz += scale) {
+			for (int cx = 0; cx < WIDTH; cx += scale) {
+				const BlockType cell = mergeCell(cx, cy, cz, scale, cellTop, getBlock);
+				for (int y = cy; y < cellTop; ++y)
+					for (int z = cz; z < cz + scale; ++z)
+						for (int x = cx; x < cx + scale; ++x)
+							snapshot.at(x, y, z) = cell;
+			}
+		}
+	}
+}
+
+// The cells of neighbor along the dir side, merged the way its own
+// snapshots are.  The snapshot range is whole cells, they line up.
+void Chunk::copyLodBorder(ChunkSnapshot &snapshot, const Direction dir, const Chunk &neighbor) const {
+	const int scale = 1 << lod;
+	auto getBlock = [&neighbor](int x, int y, int z) { return neighbor.getBlock(x, y, z); };
+	const bool xSide = dir == EAST || dir == WEST;
+	// Neighbour cells touching this chunk, and the border layer they fill
+	const int cellStart = dir == NORTH || dir == EAST ? 0 : (xSide ? WIDTH : DEPTH) - scale;
+	const int border = dir == NORTH ? DEPTH : dir == EAST ? WIDTH : -1;
+	for (int cy = snapshot.minY; cy <= snapshot.maxY; cy += scale) {
+		const int cellTop = std::min(cy + scale, snapshot.maxY + 1);
+		for (int c = 0; c < (xSide ? DEPTH : WIDTH); c += scale) {
+			const BlockType cell = xSide ? mergeCell(cellStart, cy, c, scale, cellTop, getBlock)
+			                             : mergeCell(c, cy, cellStart, scale, cellTop, getBlock);
+			for (int y = cy; y < cellTop; ++y) {
+				for (int i = c; i < c + scale; ++i) {
+					if (xSide)
+						snapshot.at(border, y, i) = cell;
+					else
+						snapshot.at(i, y, border) = cell;
+				}
+			}
+		}
+	}
+}
+
+// Same layout as takeSnapshot, but only the outermost layer of this chunk on
+// the dir side and the neighbour layer facing it are filled
+void Chunk::takeBorderSnapshot(ChunkSnapshot &snapshot, const Direction dir) const {
+	snapshot.minY = minBlockY;
+	snapshot.maxY = compressed ? minBlockY - 1 : maxBlockY;
+	snapshot.borders = 0;
+
+	const int layers = snapshot.isEmpty() ? 0 : snapshot.maxY - snapshot.minY + 1;
+	snapshot.data.assign(static_cast<std::size_t>(ChunkSnapshot::PADDED_WIDTH) * ChunkSnapshot::PADDED_DEPTH * (layers + 2),
+	                     BlockType::AIR);
+	if (snapshot.isEmpty())
+		return;
+
+	const int face = DIRECTION_FACE[dir];
+	const int slice = borderSlice(face);
+	const bool xSide = dir == EAST || dir == WEST;
+	for (int y = snapshot.minY; y <= snapshot.maxY; ++y) {
+		for (int i = 0; i < (xSide ? DEPTH : WIDTH); ++i) {
+			if (xSide)
+				snapshot.at(slice, y, i) = getBlock(slice, y, i);
+			else
+				snapshot.at(i, y, slice) = getBlock(i, y, slice);
+		}
+	}
+	copyBorder(snapshot, dir);
 }
 
 void Chunk::buildMeshData() {
-	meshVertices.clear();
-	std::vector<BlockType> blockTypeVector;	// unpacked block indices
+	ChunkSnapshot snapshot;
+	takeSnapshot(snapshot);
+	buildMeshData(snapshot);
+}
 
-    // Decode palette indices to block types
-    blockTypeVector.resize(WIDTH * HEIGHT * DEPTH);
-    std::vector<uint32_t> decodedIndices;
-    blockIndices.decodeAll(decodedIndices);
+// Only reads the snapshot, so it can run on a worker while the update thread
+// edits this chunk or its neighbours
+void Chunk::buildMeshData(const ChunkSnapshot &snapshot, ChunkMeshData &out) {
+	for (auto &part : out.parts)
+		part.clear();
+	out.builtParts = 1 << ChunkMeshData::INTERIOR;
+
+	MeshArena::Handle arena = MeshArena::acquire();
+	arena->quads.clear();
+	if (!snapshot.isEmpty()) {
+		switch (meshingMode.load()) {
+		case MeshingMode::NAIVE:
+			buildNaiveMesh(snapshot, *arena);
+			break;
+		case MeshingMode::GREEDY:
+			buildGreedyMesh(snapshot, *arena);
+			break;
+		case MeshingMode::BINARY:
+			buildBinaryMesh(snapshot, *arena);
+			break;
+		}
+	}
+	writeQuads(arena->quads, out.parts[ChunkMeshData::INTERIOR], out.interiorFaceQuads);
+	out.partHashes[ChunkMeshData::INTERIOR] = hashMeshInputs(snapshot, ChunkMeshData::INTERIOR);
+	out.minY = static_cast<int16_t>(snapshot.getMinY());
+	out.maxY = static_cast<int16_t>(snapshot.getMaxY());
+	buildSectionConnectivity(snapshot, out, *arena);
+	buildOccluders(snapshot, out);
+
+	for (int dir = 0; dir < 4; ++dir) {
+		if (snapshot.hasBorder(static_cast<Direction>(dir)))
+			buildBorderStrip(snapshot, static_cast<Direction>(dir), out, *arena);
+	}
+}
 
-    for (size_t i = 0; i < blockTypeVector.size(); ++i) {
-        uint32_t paletteIndex = decodedIndices[i];
-        blockTypeVector[i] = palette[paletteIndex];
-    }
+void Chunk::buildMeshData(const ChunkSnapshot &snapshot) {
+	ChunkMeshData mesh;
+	buildMeshData(snapshot, mesh);
+	setMeshData(std::move(mesh));
+}
 
-    auto getBlockOrNeighbor = [&](int x, int y, int z, int dx, int dy, int dz, Direction dir) -> BlockType {
-        if (x + dx < 0 || x + dx >= WIDTH ||
-            z + dz < 0 || z + dz >= DEPTH) 
-        {
-            auto neighbor = adjacentChunks[dir].lock();
-            if (!neighbor) return BlockType::AIR;
-            int nx = (dx == -1 ? WIDTH - 1 : (dx == 1 ? 0 : x));
-            int nz = (dz == -1 ? DEPTH - 1 : (dz == 1 ? 0 : z));
-            return neighbor->getBlock(nx, y + dy, nz);
-        }
-        if (y + dy < 0 || y + dy >= HEIGHT) 
-            return BlockType::AIR; // top or bottom world edge inside chunk
-        return blockTypeVector[(x + dx) + WIDTH * ((y + dy) + HEIGHT * (z + dz))];
-    };
+// A strip is the single outward slice of one X/Z face, so it is meshed like
+// one slice of the greedy mesher (one quad per face in naive mode)
+void Chunk::buildBorderStrip(const ChunkSnapshot &snapshot, const Direction dir, ChunkMeshData &out,
+                             MeshArena &arena) {
+	out.builtParts |= 1 << dir;
+	arena.quads.clear();
+	if (!snapshot.isEmpty()) {
+		const int face = DIRECTION_FACE[dir];
+		meshSlice(snapshot, face, borderSlice(face), meshingMode.load() != MeshingMode::NAIVE, arena);
+	}
+	std::array<uint32_t, 6> faceQuads;
+	writeQuads(arena.quads, out.parts[dir], faceQuads);
+	out.partHashes[dir] = hashMeshInputs(snapshot, dir);
+}
+
+void Chunk::buildBorderStrip(const ChunkSnapshot &snapshot, const Direction dir, ChunkMeshData &out) {
+	buildBorderStrip(snapshot, dir, out, *MeshArena::acquire());
+}
+
+void Chunk::buildBorderStrip(const ChunkSnapshot &snapshot, const Direction dir) {
+	std::lock_guard<std::mutex> lock(meshMutex);
+	buildBorderStrip(snapshot, dir, meshData);
+}
 
+// Flood fill of the non-opaque blocks of each section.  The faces an open
+// region touches can all be seen from each other through the section.
+void Chunk::buildSectionConnectivity(const ChunkSnapshot &snapshot, ChunkMeshData &out, MeshArena &arena) {
+	constexpr int sectionCells = WIDTH * DEPTH * SECTION_HEIGHT;
+	constexpr uint8_t OPEN = 1, VISITED = 2;
+	std::vector<uint8_t> &cells = arena.sectionCells;
+	std::vector<uint32_t> &stack = arena.floodStack;
+	cells.resize(sectionCells);
+
+	for (int section = 0; section < SECTION_COUNT; ++section) {
+		const int bottom = section * SECTION_HEIGHT;
+		if (snapshot.isEmpty() || bottom + SECTION_HEIGHT - 1 < snapshot.minY || bottom > snapshot.maxY) {
+			out.sectionConnectivity[section] = ALL_SECTION_FACES_CONNECTED; // only air
+			continue;
+		}
+		int openCells = 0;
+		for (int ly = 0; ly < SECTION_HEIGHT; ++ly) {
+			const int y = bottom + ly;
+			for (int z = 0; z < DEPTH; ++z) {
+				uint8_t *cellRow = &cells[WIDTH * (z + DEPTH * ly)];
+				if (y < snapshot.minY || y > snapshot.maxY) {
+					std::fill_n(cellRow, WIDTH, OPEN);
+					openCells += WIDTH;
+					continue;
+				}
+				const BlockType *row = snapshot.row(y, z) + 1;
+				for (int x = 0; x < WIDTH; ++x) {
+					cellRow[x] = isOpaque(row[x]) ? 0 : OPEN;
+					openCells += cellRow[x];
+				}
+			}
+		}
+		if (openCells == sectionCells) {
+			out.sectionConnectivity[section] = ALL_SECTION_FACES_CONNECTED;
+			continue;
+		}
+
+		uint16_t connectivity = 0;
+		for (int start = 0; start < sectionCells && openCells > 0; ++start) {
+			if (cells[start] != OPEN)
+				continue;
+			uint8_t faces = 0;
+			cells[start] = VISITED;
+			--openCells;
+			stack.clear();
+			stack.push_back(static_cast<uint32_t>(start));
+			while (!stack.empty()) {
+				const int cell = static_cast<int>(stack.back());
+				stack.pop_back();
+				const int x = cell % WIDTH;
+				const int z = cell / WIDTH % DEPTH;
+				const int ly = cell / (WIDTH * DEPTH);
+				// Neighbour cell in each face direction, or the face reached
+				const bool onFace[6] = { z == DEPTH - 1, z == 0, ly == SECTION_HEIGHT - 1, ly == 0, x == WIDTH - 1, x == 0 };
+				const int step[6] = { WIDTH, -WIDTH, WIDTH * DEPTH, -WIDTH * DEPTH, 1, -1 };
+				for (int face = 0; face < 6; ++face) {
+					if (onFace[face]) {
+						faces |= 1 << face;
+						continue;
+					}
+					const int next = cell + step[face];
+					if (cells[next] == OPEN) {
+						cells[next] = VISITED;
+						--openCells;
+						stack.push_back(static_cast<uint32_t>(next));
+					}
+				}
+			}
+			for (int a = 0; a < 6; ++a)
+				for (int b = a + 1; b < 6; ++b)
+					if ((faces >> a & 1) && (faces >> b & 1))
+						connectivity |= 1 << connectivityBit(a, b);
+		}
+		out.sectionConnectivity[section] = connectivity;
+	}
+}
+
+// The run of fully opaque layers of each cell starting at, or first found
+// under, its lowest column top.  Caves usually leave the layers right under
+// the surface whole.
+void Chunk::buildOccluders(const ChunkSnapshot &snapshot, ChunkMeshData &out) {
+	constexpr int cellWidth = WIDTH / OCCLUDER_CELLS;
+	constexpr int cellDepth = DEPTH / OCCLUDER_CELLS;
+	for (int cellZ = 0; cellZ < OCCLUDER_CELLS; ++cellZ) {
+		for (int cellX = 0; cellX < OCCLUDER_CELLS; ++cellX) {
+			ChunkMeshData::SolidRange &range = out.occluders[cellX + OCCLUDER_CELLS * cellZ];
+			range = ChunkMeshData::SolidRange();
+			if (snapshot.isEmpty())
+				continue;
+			int surface = snapshot.maxY;
+			for (int z = cellZ * cellDepth; z < (cellZ + 1) * cellDepth; ++z)
+				for (int x = cellX * cellWidth; x < (cellX + 1) * cellWidth; ++x)
+					surface = std::min(surface, snapshot.getColumnHeight(x, z));
+
+			auto layerSolid = [&](const int y) {
+				for (int z = cellZ * cellDepth; z < (cellZ + 1) * cellDepth; ++z) {
+					const BlockType *row = snapshot.row(y, z) + 1 + cellX * cellWidth;
+					for (int x = 0; x < cellWidth; ++x)
+						if (!isOpaque(row[x]))
+							return false;
+				}
+				return true;
+			};
+			int y = std::min(surface, snapshot.maxY);
+			while (y >= snapshot.minY && !layerSolid(y))
+				--y;
+			const int top = y + 1;
+			while (y >= snapshot.minY && layerSolid(y))
+				--y;
+			range.bottom = static_cast<int16_t>(y + 1);
+			range.top = static_cast<int16_t>(std::max(top, y + 1));
+		}
+	}
+}
+
+void Chunk::setMeshData(ChunkMeshData &&data) {
+	std::lock_guard<std::mutex> lock(meshMutex);
+	releaseMeshParts();
+	meshData = std::move(data);
+	meshPartsOnCpu = true;
+}
+
+namespace {
+// FNV-1a on 64-bit words with a xorshift so the high bits mix down too
+constexpr uint64_t HASH_BASIS = 0xcbf29ce484222325ull;
+
+inline uint64_t hashWord(uint64_t hash, const uint64_t word) {
+	hash = (hash ^ word) * 0x100000001b3ull;
+	return hash ^ (hash >> 29);
+}
+
+inline uint64_t hashBlocks(uint64_t hash, const BlockType *blocks, const std::size_t count) {
+	static_assert(sizeof(BlockType) == 1, "blocks are hashed 8 at a time");
+	std::size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		uint64_t word;
+		std::memcpy(&word, blocks + i, sizeof(word));
+		hash = hashWord(hash, word);
+	}
+	uint64_t tail = 0;
+	std::memcpy(&tail, blocks + i, count - i);
+	return hashWord(hash, tail);
+}
+}
+
+uint64_t Chunk::hashMeshInputs(const ChunkSnapshot &snapshot, const int part) {
+	uint64_t hash = HASH_BASIS;
+	hash = hashWord(hash, static_cast<uint64_t>(meshingMode.load()) | static_cast<uint64_t>(part) << 8);
+	hash = hashWord(hash, static_cast<uint32_t>(snapshot.getMinY()) | static_cast<uint64_t>(static_cast<uint32_t>(snapshot.getMaxY())) << 32);
+	if (snapshot.isEmpty())
+		return hash;
+
+	for (int y = snapshot.getMinY(); y <= snapshot.getMaxY(); ++y) {
+		switch (part) {
+		case ChunkMeshData::INTERIOR:
+			for (int z = 0; z < DEPTH; ++z)
+				hash = hashBlocks(hash, snapshot.row(y, z) + 1, WIDTH);
+			break;
+		case NORTH:
+		case SOUTH: {
+			const int z = part == NORTH ? DEPTH - 1 : 0;
+			hash = hashBlocks(hash, snapshot.row(y, z) + 1, WIDTH);
+			hash = hashBlocks(hash, snapshot.row(y, part == NORTH ? DEPTH : -1) + 1, WIDTH);
+			break;
+		}
+		default: {
+			// Columns across the rows, own block then the neighbour one
+			const int x = part == EAST ? WIDTH - 1 : 0;
+			const int outside = part == EAST ? WIDTH : -1;
+			std::array<BlockType, 2 * DEPTH> column;
+			for (int z = 0; z < DEPTH; ++z) {
+				column[2 * z] = snapshot.at(x, y, z);
+				column[2 * z + 1] = snapshot.at(outside, y, z);
+			}
+			hash = hashBlocks(hash, column.data(), column.size());
+			break;
+		}
+		}
+	}
+	return hash;
+}
+
+bool Chunk::refreshCachedMesh(const ChunkSnapshot &snapshot, ChunkMeshData &mesh) {
+	if (!(mesh.builtParts & (1 << ChunkMeshData::INTERIOR))
+		|| mesh.partHashes[ChunkMeshData::INTERIOR] != hashMeshInputs(snapshot, ChunkMeshData::INTERIOR))
+		return false;
+	// Not saved with the cache, the voxels are the same
+	mesh.minY = static_cast<int16_t>(snapshot.getMinY());
+	mesh.maxY = static_cast<int16_t>(snapshot.getMaxY());
+
+	for (int dir = 0; dir < 4; ++dir) {
+		const auto direction = static_cast<Direction>(dir);
+		if (!snapshot.hasBorder(direction)) {
+			mesh.parts[dir].clear();
+			mesh.builtParts &= ~(1 << dir);
+		}
+		else if (!(mesh.builtParts & (1 << dir)) || mesh.partHashes[dir] != hashMeshInputs(snapshot, dir))
+			buildBorderStrip(snapshot, direction, mesh);
+	}
+	return true;
+}
+
+uint8_t Chunk::getLinkedBorders() const {
+	uint8_t borders = 0;
+	for (int dir = 0; dir < 4; ++dir) {
+		auto neighbor = adjacentChunks[dir].lock();
+		if (neighbor && !neighbor->isCompressed())
+			borders |= 1 << dir;
+	}
+	return borders;
+}
+
+uint8_t Chunk::getSameLodBorders() const {
+	uint8_t borders = 0;
+	for (int dir = 0; dir < 4; ++dir) {
+		auto neighbor = adjacentChunks[dir].lock();
+		if (neighbor && !neighbor->isCompressed() && neighbor->lod == lod)
+			borders |= 1 << dir;
+	}
+	return borders;
+}
+
+// One quad per visible face
+void Chunk::buildNaiveMesh(const ChunkSnapshot &snapshot, MeshArena &arena) {
+    // Only walk the occupied part of each column, everything above the
+    // column height is air and emits nothing.
     for (int x = 0; x < WIDTH; ++x) {
-        for (int y = 0; y < HEIGHT; ++y) {
-            for (int z = 0; z < DEPTH; ++z) {
-                int idx = x + WIDTH * (y + HEIGHT * z);
-                if (blockTypeVector[idx] == BlockType::AIR) continue;
-
-                // FRONT (+Z)
-                if (getBlockOrNeighbor(x, y, z, 0, 0, +1, NORTH) == BlockType::AIR)
-                    addFace(x, y, z, 0);
-
-                // BACK (-Z)
-                if (getBlockOrNeighbor(x, y, z, 0, 0, -1, SOUTH) == BlockType::AIR)
-                    addFace(x, y, z, 1);
-
-                // TOP (+Y) – no vertical neighbor chunks
-                if (y == HEIGHT - 1 || getBlockOrNeighbor(x, y, z, 0, +1, 0, NONE) == BlockType::AIR)
-                    addFace(x, y, z, 2);
-
-                // BOTTOM (-Y)
-                if (y == 0 || getBlockOrNeighbor(x, y, z, 0, -1, 0, NONE) == BlockType::AIR)
-                    addFace(x, y, z, 3);
-
-                // RIGHT (+X)
-                if (getBlockOrNeighbor(x, y, z, +1, 0, 0, EAST) == BlockType::AIR)
-                    addFace(x, y, z, 4);
-
-                // LEFT (-X)
-                if (getBlockOrNeighbor(x, y, z, -1, 0, 0, WEST) == BlockType::AIR)
-                    addFace(x, y, z, 5);
+        for (int z = 0; z < DEPTH; ++z) {
+            const int top = snapshot.getColumnHeight(x, z);
+            for (int y = snapshot.getMinY(); y <= top; ++y) {
+                const BlockType type = snapshot.at(x, y, z);
+                if (type == BlockType::AIR) continue;
+
+                const int p[3] = { x, y, z };
+                for (int face = 0; face < 6; ++face) {
+                    const FaceAxes &axes = FACE_AXES[face];
+                    if (p[axes.normal] == borderSlice(face))
+                        continue;
+                    if (!isFaceOccluded(type, snapshot.at(x + axes.dx, y + axes.dy, z + axes.dz)))
+                        arena.quads.push_back(makeQuad(x, y, z, face, 1, 1, type));
+                }
             }
         }
     }
 }
 
-void Chunk::uploadMesh() {
-    // Upload mesh to OpenGL (unchanged)
-    if (VAO == 0)
-        glGenVertexArrays(1, &VAO);
-    if (VBO == 0)
-        glGenBuffers(1, &VBO);
-
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, meshVertices.size() * sizeof(float), meshVertices.data(), GL_STATIC_DRAW);
-
-    GLsizei stride = 9 * sizeof(float);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, static_cast<void *>(nullptr));
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(5 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void *>(6 * sizeof(float)));
-    glEnableVertexAttribArray(3);
-    
-    meshVerticesSize = meshVertices.size();
-    meshVertices.clear();
-    meshVertices.shrink_to_fit();
+void Chunk::buildGreedyMesh(const ChunkSnapshot &snapshot, MeshArena &arena) {
+	const int lo[3] = { 0, snapshot.getMinY(), 0 };
+	const int hi[3] = { WIDTH, snapshot.getMaxY() + 1, DEPTH };
+
+	for (int face = 0; face < 6; ++face) {
+		const int normal = FACE_AXES[face].normal;
+		for (int slice = lo[normal]; slice < hi[normal]; ++slice) {
+			if (slice != borderSlice(face))
+				meshSlice(snapshot, face, slice, true, arena);
+		}
+	}
+}
+
+// Visible faces of one slice, merged into the largest rectangles of the same
+// block type when merge is set: rows are grown along u first, then extended
+// along v while the whole row matches.  arena.sliceMask is all air between
+// calls.
+void Chunk::meshSlice(const ChunkSnapshot &snapshot, const int face, const int slice, const bool merge,
+                      MeshArena &arena) {
+	std::vector<BlockType> &mask = arena.sliceMask;
+	// Only the occupied Y range can hold faces
+	const int lo[3] = { 0, snapshot.getMinY(), 0 };
+	const int hi[3] = { WIDTH, snapshot.getMaxY() + 1, DEPTH };
+	const FaceAxes &axes = FACE_AXES[face];
+	const int sizeU = hi[axes.u] - lo[axes.u];
+	const int sizeV = hi[axes.v] - lo[axes.v];
+	if (mask.size() != static_cast<std::size_t>(sizeU * sizeV))
+		mask.assign(sizeU * sizeV, BlockType::AIR);
+
+	int p[3];
+	p[axes.normal] = slice;
+
+	for (int v = 0; v < sizeV; ++v) {
+		p[axes.v] = lo[axes.v] + v;
+		for (int u = 0; u < sizeU; ++u) {
+			p[axes.u] = lo[axes.u] + u;
+			const BlockType type = snapshot.at(p[0], p[1], p[2]);
+			if (type != BlockType::AIR
+			    && !isFaceOccluded(type, snapshot.at(p[0] + axes.dx, p[1] + axes.dy, p[2] + axes.dz)))
+				mask[u + sizeU * v] = type;
+		}
+	}
+
+	for (int v = 0; v < sizeV; ++v) {
+		for (int u = 0; u < sizeU; ) {
+			const BlockType type = mask[u + sizeU * v];
+			if (type == BlockType::AIR) {
+				++u;
+				continue;
+			}
+
+			int width = 1;
+			int height = 1;
+			if (merge) {
+				while (u + width < sizeU && mask[u + width + sizeU * v] == type)
+					++width;
+
+				for (; v + height < sizeV; ++height) {
+					const BlockType *row = &mask[u + sizeU * (v + height)];
+					if (std::any_of(row, row + width, [type](BlockType t) { return t != type; }))
+						break;
+				}
+			}
+
+			for (int dv = 0; dv < height; ++dv)
+				std::fill_n(&mask[u + sizeU * (v + dv)], width, BlockType::AIR);
+
+			p[axes.u] = lo[axes.u] + u;
+			p[axes.v] = lo[axes.v] + v;
+			arena.quads.push_back(makeQuad(p[0], p[1], p[2], face, width, height, type));
+			u += width;
+		}
+	}
 }
 
+void Chunk::uploadMesh(ChunkRenderer &renderer) {
+    std::lock_guard<std::mutex> lock(meshMutex);
+    if (!meshPartsOnCpu)
+        return; // nothing built since the parts were released
+    if (meshRenderer && meshRenderer != &renderer)
+        meshRenderer->release(meshAllocation);
+    meshRenderer = &renderer;
+
+    // One run per face: the interior quads of the face, then the border
+    // strip holding that face if there is one
+    constexpr std::size_t quadWords = 4 * VERTEX_WORDS;
+    const std::size_t words = meshData.wordCount();
+    renderer.reserve(meshAllocation, static_cast<uint32_t>(words / quadWords));
+
+    std::size_t offset = 0;
+    std::size_t interiorOffset = 0;
+    auto copy = [&](const uint32_t *data, std::size_t count) {
+        renderer.write(meshAllocation, offset, data, count);
+        offset += count;
+    };
+    const std::vector<uint32_t> &interior = meshData.parts[ChunkMeshData::INTERIOR];
+    for (int face = 0; face < 6; ++face) {
+        faceQuadStart[face] = static_cast<uint32_t>(offset / quadWords);
+        const std::size_t interiorWords = meshData.interiorFaceQuads[face] * quadWords;
+        copy(interior.data() + interiorOffset, interiorWords);
+        interiorOffset += interiorWords;
+        if (FACE_DIRECTION[face] != NONE) {
+            const std::vector<uint32_t> &strip = meshData.parts[FACE_DIRECTION[face]];
+            copy(strip.data(), strip.size());
+        }
+    }
+    faceQuadStart[6] = static_cast<uint32_t>(offset / quadWords);
+    meshVertexCount = words / VERTEX_WORDS;
+
+    // Runs are sorted by the section of the top block of their quads, the
+    // start of a section is the first quad reaching it
+    sectionQuadStart.resize(12 * (SECTION_COUNT + 1));
+    auto indexSections = [&](int face, int run, const uint32_t *quads, uint32_t first, uint32_t count) {
+        int section = 0;
+        for (uint32_t q = 0; q < count; ++q) {
+            const int top = packedQuadTopSection(quads + q * quadWords);
+            while (section <= top)
+                sectionStart(face, run, section++) = first + q;
+        }
+        while (section <= SECTION_COUNT)
+            sectionStart(face, run, section++) = first + count;
+    };
+    interiorOffset = 0;
+    for (int face = 0; face < 6; ++face) {
+        const uint32_t interiorQuads = meshData.interiorFaceQuads[face];
+        indexSections(face, 0, interior.data() + interiorOffset, faceQuadStart[face], interiorQuads);
+        interiorOffset += interiorQuads * quadWords;
+        const std::vector<uint32_t> *strip = FACE_DIRECTION[face] != NONE ? &meshData.parts[FACE_DIRECTION[face]] : nullptr;
+        indexSections(face, 1, strip ? strip->data() : nullptr, faceQuadStart[face] + interiorQuads,
+                      strip ? static_cast<uint32_t>(strip->size() / quadWords) : 0);
+    }
+
+    // What the culler and startMeshRead need, the parts may be gone by then
+    copyUploadedLayout();
 
-void Chunk::addFace(int x, int y, int z, int face) {
-    const float faceX = static_cast<float>(originX + x);
-    const float faceY = static_cast<float>(y);
-    const float faceZ = static_cast<float>(originZ + z);
+    // Every neighbour is in, no strip will be patched on its own anymore
+    if ((meshData.builtParts & ChunkMeshData::ALL_BORDER_STRIPS) == ChunkMeshData::ALL_BORDER_STRIPS)
+        releaseMeshParts();
+}
 
-    const float TILE_W = 1.0f / ATLAS_COLS;
-    const float TILE_H = 1.0f / ATLAS_ROWS;
+void Chunk::recordMeshLayout() {
+    std::lock_guard<std::mutex> lock(meshMutex);
+    copyUploadedLayout();
+}
 
-    static const float faceData[6][18] = {
-        // FRONT face (Z+)
-        { 0,0,1,  1,0,1,  1,1,1,
-        1,1,1,  0,1,1,  0,0,1 },
+// meshMutex held
+void Chunk::copyUploadedLayout() {
+    copyMeshLayout(meshData, cold->uploadedMesh);
+    meshMinY = meshData.minY;
+    meshMaxY = meshData.maxY;
+}
 
-        // BACK face (Z-)
-        { 1,0,0,  0,0,0,  0,1,0,
-        0,1,0,  1,1,0,  1,0,0 },
+bool Chunk::extractMeshData(ChunkMeshData &out) {
+    std::lock_guard<std::mutex> lock(meshMutex);
+    if (!(meshData.builtParts & (1 << ChunkMeshData::INTERIOR)) || !meshPartsOnCpu)
+        return false;
+    copyMeshLayout(meshData, out);
+    out.parts = std::move(meshData.parts);
+    for (auto &part : meshData.parts)
+        part.clear();
+    meshPartsOnCpu = false;
+    return true;
+}
+
+bool Chunk::startMeshRead(ChunkMeshReadback &read) const {
+    const ChunkMeshData &uploaded = cold->uploadedMesh;
+    if (!(uploaded.builtParts & (1 << ChunkMeshData::INTERIOR)) || meshAllocation.quadCount == 0)
+        return false;
+    copyMeshLayout(uploaded, read.layout);
+    read.faceQuadStart = faceQuadStart;
+    meshRenderer->startRead(meshAllocation, meshVertexCount * VERTEX_WORDS, read.gpu);
+    return read.gpu.buffer != 0;
+}
 
-        // TOP face (Y+)
-        { 0,1,1,  1,1,1,  1,1,0,
-        1,1,0,  0,1,0,  0,1,1 },
+bool Chunk::finishMeshRead(ChunkRenderer &renderer, ChunkMeshReadback &read, ChunkMeshData &out) {
+    std::vector<uint32_t> vertices = MeshArena::takeVertexBuffer(read.gpu.wordCount);
+    if (!renderer.finishRead(read.gpu, vertices)) {
+        MeshArena::recycleVertexBuffer(std::move(vertices));
+        return false;
+    }
+    const ChunkMeshData &uploaded = read.layout;
+    const std::array<uint32_t, 7> &faceQuadStart = read.faceQuadStart;
+    copyMeshLayout(uploaded, out);
+
+    // Split the face ranges uploadMesh laid out back into parts
+    constexpr std::size_t quadWords = 4 * VERTEX_WORDS;
+
+    std::size_t interiorWords = 0;
+    for (const uint32_t quads : uploaded.interiorFaceQuads)
+        interiorWords += quads * quadWords;
+    std::vector<uint32_t> &interior = out.parts[ChunkMeshData::INTERIOR];
+    interior = MeshArena::takeVertexBuffer(interiorWords);
+    interior.reserve(interiorWords);
+    for (int face = 0; face < 6; ++face) {
+        const uint32_t *range = vertices.data() + faceQuadStart[face] * quadWords;
+        const std::size_t faceWords = uploaded.interiorFaceQuads[face] * quadWords;
+        interior.insert(interior.end(), range, range + faceWords);
+        if (FACE_DIRECTION[face] != NONE) {
+            std::vector<uint32_t> &strip = out.parts[FACE_DIRECTION[face]];
+            strip.assign(range + faceWords, range + (faceQuadStart[face + 1] - faceQuadStart[face]) * quadWords);
+        }
+    }
+    MeshArena::recycleVertexBuffer(std::move(vertices));
+    return true;
+}
 
-        // BOTTOM face (Y-)
-        { 0,0,0,  1,0,0,  1,0,1,
-        1,0,1,  0,0,1,  0,0,0 },
+// The buffers go back to the MeshArena pool for the next chunk to mesh
+void Chunk::releaseMeshParts() {
+    for (auto &part : meshData.parts)
+        MeshArena::recycleVertexBuffer(std::move(part));
+    meshPartsOnCpu = false;
+}
 
-        // RIGHT face (X+)
-        { 1,0,1,  1,0,0,  1,1,0,
-        1,1,0,  1,1,1,  1,0,1 },
+void Chunk::buildBinaryMesh(const ChunkSnapshot &snapshot, MeshArena &arena) {
+	arena.binaryMesher.build(snapshot, arena.quads);
+}
 
-        // LEFT face (X-)
-        { 0,0,0,  0,0,1,  0,1,1,
-        0,1,1,  0,1,0,  0,0,0 }
-    };
+void Chunk::writeQuads(const std::vector<MeshQuad> &quads, std::vector<uint32_t> &out,
+                       std::array<uint32_t, 6> &faceQuads) {
+	constexpr std::size_t quadWords = 4 * VERTEX_WORDS;
+	const std::size_t words = quads.size() * quadWords;
+	if (out.capacity() < words) {
+		MeshArena::recycleVertexBuffer(std::move(out));
+		out = MeshArena::takeVertexBuffer(words);
+	}
+	out.resize(words);
+
+	// Counting sort on the face, then the section of the top block
+	std::array<uint32_t, 6 * SECTION_COUNT> next{};
+	auto key = [](const MeshQuad &quad) { return quad.face * SECTION_COUNT + quadTopSection(quad); };
+	for (const MeshQuad &quad : quads)
+		++next[key(quad)];
+	faceQuads.fill(0);
+	for (int k = 0, first = 0; k < 6 * SECTION_COUNT; ++k) {
+		faceQuads[k / SECTION_COUNT] += next[k];
+		const int count = static_cast<int>(next[k]);
+		next[k] = static_cast<uint32_t>(first);
+		first += count;
+	}
+	for (const MeshQuad &quad : quads)
+		writeQuad(&out[next[key(quad)]++ * quadWords], quad);
+}
 
-    static const float uvCoords[12] = {
-        0, 0,
-        1, 0,
-        1, 1,
-        1, 1,
-        0, 1,
-        0, 0
+// Quad covering sizeU x sizeV faces starting at block (x, y, z), as four
+// packed vertices (see the layout next to VERTEX_WORDS in Chunk.hpp).  The
+// shaders rebuild the normal and the UVs from the face and the position.
+void Chunk::writeQuad(uint32_t *vertices, const MeshQuad &quad) {
+    // Corners in the order expected by the quad index buffer
+    static const uint8_t faceCorners[6][4][3] = {
+        { {0,0,1}, {1,0,1}, {1,1,1}, {0,1,1} }, // FRONT face (Z+)
+        { {1,0,0}, {0,0,0}, {0,1,0}, {1,1,0} }, // BACK face (Z-)
+        { {0,1,1}, {1,1,1}, {1,1,0}, {0,1,0} }, // TOP face (Y+)
+        { {0,0,0}, {1,0,0}, {1,0,1}, {0,0,1} }, // BOTTOM face (Y-)
+        { {1,0,1}, {1,0,0}, {1,1,0}, {1,1,1} }, // RIGHT face (X+)
+        { {0,0,0}, {0,0,1}, {0,1,1}, {0,1,0} }  // LEFT face (X-)
     };
 
-    static const glm::vec3 faceNormals[6] = {
-        {  0,  0,  1 }, // front
-        {  0,  0, -1 }, // back
-        {  0,  1,  0 }, // top
-        {  0, -1,  0 }, // bottom
-        {  1,  0,  0 }, // right
-        { -1,  0,  0 }  // left
-    };
+    int scale[3] = { 1, 1, 1 };
+    scale[FACE_AXES[quad.face].u] = quad.sizeU;
+    scale[FACE_AXES[quad.face].v] = quad.sizeV;
 
-    glm::vec3 normal = faceNormals[face];
+    // No light data yet: full light, no ambient occlusion
+    const uint32_t tile = getBlockInfo(quad.type).faceTiles[quad.face];
+    const uint32_t attributes = tile | (15u << 8) | (3u << 12);
 
-    // Get block type for this position
-    const BlockType type = getBlock(x, y, z);
+    for (const auto &corner : faceCorners[quad.face]) {
+        const auto px = static_cast<uint32_t>(quad.x + corner[0] * scale[0]);
+        const auto py = static_cast<uint32_t>(quad.y + corner[1] * scale[1]);
+        const auto pz = static_cast<uint32_t>(quad.z + corner[2] * scale[2]);
 
-    // Determine UV offset in atlas based on block type and face
-    glm::vec2 tileCoord = getTextureOffset(type, face);
-    glm::vec2 offset = { tileCoord.x * TILE_W, tileCoord.y * TILE_H };
-
-    // Build six vertices for this face using the computed light
-    for (int i = 0; i < 6; ++i) {
-        float px = faceX + faceData[face][i * 3 + 0];
-        float py = faceY + faceData[face][i * 3 + 1];
-        float pz = faceZ + faceData[face][i * 3 + 2];
-
-        float baseU = uvCoords[i * 2 + 0]; // 0 → 1
-        float baseV = uvCoords[i * 2 + 1]; // 0 → 1
-
-        float u = baseU * TILE_W + offset.x;
-        float v = baseV * TILE_H + offset.y;
-
-        meshVertices.push_back(px);    // position.x
-        meshVertices.push_back(py);    // position.y
-        meshVertices.push_back(pz);    // position.z
-        meshVertices.push_back(u);     // texture u
-        meshVertices.push_back(v);     // texture v
-        meshVertices.push_back(py);    // send Y again for gradient
-        meshVertices.push_back(normal.x);
-        meshVertices.push_back(normal.y);
-        meshVertices.push_back(normal.z);
+        *vertices++ = px | (pz << 7) | (py << 14) | (static_cast<uint32_t>(quad.face) << 27);
+        *vertices++ = attributes;
     }
 }
 
-void Chunk::draw(const std::shared_ptr<Shader>& shader) const {
-    shader->use();
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_TRIANGLES, 0, meshVerticesSize / 9);
+void Chunk::appendDrawCommands(ChunkRenderer::DrawList &list, const glm::ivec3 &cameraCell,
+                               const int firstSection) const {
+    if (meshVertexCount == 0)
+        return;
+
+    // A face direction is drawn when the camera is in front of at least one
+    // plane its faces can lie on, i.e. past the matching side of the AABB
+    const int chunkX = originX / WIDTH;
+    const int chunkZ = originZ / DEPTH;
+    const bool faceVisible[6] = {
+        chunkZ <= cameraCell.z, chunkZ >= cameraCell.z,             // +Z, -Z
+        cameraCell.y >= meshMinY, cameraCell.y <= meshMaxY,         // +Y, -Y
+        chunkX <= cameraCell.x, chunkX >= cameraCell.x,             // +X, -X
+    };
+
+    // The interior and strip runs of each face from firstSection up.
+    // Adjacent ranges are merged, so from section 0 at most three are left.
+    const auto baseInstance = static_cast<GLuint>(list.origins.size());
+    const std::size_t firstCommand = list.commands.size();
+    uint32_t runEnd = 0;
+    for (int face = 0; face < 6; ++face) {
+        if (!faceVisible[face])
+            continue;
+        for (int run = 0; run < 2; ++run) {
+            const uint32_t first = sectionStart(face, run, firstSection);
+            const uint32_t last = sectionStart(face, run, SECTION_COUNT);
+            if (first == last)
+                continue;
+            if (list.commands.size() > firstCommand && runEnd == first) {
+                list.commands.back().count += (last - first) * 6;
+            } else {
+                list.commands.push_back({ (last - first) * 6, 1, first * 6,
+                                          static_cast<GLint>(meshAllocation.firstQuad * 4), baseInstance });
+            }
+            runEnd = last;
+        }
+    }
+    if (list.commands.size() != firstCommand)
+        list.origins.emplace_back(originX, 0, originZ, 0);
 }
 
 void Chunk::saveToStream(std::ostream& out) const {
@@ -789,7 +1488,8 @@ void Chunk::saveToStream(std::ostream& out) const {
     uint32_t paletteSize = static_cast<uint32_t>(palette.size());
     out.write(reinterpret_cast<const char*>(&paletteSize), sizeof(paletteSize));
 
-    for (const auto& block : palette) {
+    for (uint32_t i = 0; i < paletteSize; ++i) {
+        const BlockType block = palette[i];
         out.write(reinterpret_cast<const char*>(&block), sizeof(block));
     }
 
@@ -806,14 +1506,87 @@ void Chunk::loadFromStream(std::istream& in) {
     uint32_t paletteSize;
     in.read(reinterpret_cast<char*>(&paletteSize), sizeof(paletteSize));
 
-    palette.resize(paletteSize);
-    paletteMap.clear();
+    palette.clear();
 
     for (uint32_t i = 0; i < paletteSize; ++i) {
-        in.read(reinterpret_cast<char*>(&palette[i]), sizeof(BlockType));
-        paletteMap[palette[i]] = i; // rebuild map
+        BlockType block;
+        in.read(reinterpret_cast<char*>(&block), sizeof(block));
+        palette.indexOf(block);
     }
 
 	// Load block data
     blockIndices.loadFromStream(in);
+
+    std::vector<BlockType> blocks;
+    decodeBlocks(blocks);
+    rebuildHeightMap(blocks);
+}
+
+// Serialises the palette and packed indices and deflates them. Only reads the
+// chunk, so it can run on a worker while the update thread keeps using it
+// (World holds the edits to the chunk back until the job is done).
+std::vector<unsigned char> Chunk::compressBlocks() const {
+    std::ostringstream raw(std::ios::binary);
+    saveToStream(raw);
+    const std::string bytes = raw.str();
+
+    // Blob layout: uint32 raw size followed by the zlib stream
+    const auto rawSize = static_cast<uint32_t>(bytes.size());
+    uLongf packedSize = compressBound(rawSize);
+    std::vector<unsigned char> blob(sizeof(rawSize) + packedSize);
+    std::memcpy(blob.data(), &rawSize, sizeof(rawSize));
+
+    const int status = compress2(blob.data() + sizeof(rawSize), &packedSize,
+                                 reinterpret_cast<const Bytef *>(bytes.data()), rawSize, Z_BEST_SPEED);
+    if (status != Z_OK) {
+        std::cerr << "Chunk::compressBlocks: zlib error " << status << std::endl;
+        return {};
+    }
+    blob.resize(sizeof(rawSize) + packedSize);
+    blob.shrink_to_fit();
+    return blob;
+}
+
+bool Chunk::inflateBlocks(const std::vector<unsigned char> &blob, std::string &raw) {
+    uint32_t rawSize = 0;
+    if (blob.size() < sizeof(rawSize))
+        return false;
+    std::memcpy(&rawSize, blob.data(), sizeof(rawSize));
+
+    raw.resize(rawSize);
+    uLongf outSize = rawSize;
+    const int status = uncompress(reinterpret_cast<Bytef *>(raw.data()), &outSize,
+                                  blob.data() + sizeof(rawSize), blob.size() - sizeof(rawSize));
+    if (status != Z_OK || outSize != rawSize) {
+        std::cerr << "Chunk::inflateBlocks: zlib error " << status << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Update thread: swap the resident voxels for the compressed blob.  The GPU
+// mesh stays until the render thread calls releaseGL.
+void Chunk::storeCompressed(std::vector<unsigned char> &&blob) {
+    if (blob.empty())
+        return;
+
+    cold->compressedBlocks = std::move(blob);
+    compressed = true;
+
+    palette.clear();
+    blockIndices = BitPackedArray(0, blockIndices.bitsPerEntry());
+
+    std::lock_guard<std::mutex> lock(meshMutex);
+    releaseMeshParts();
+    meshData.builtParts = 0;
+}
+
+// Update thread: reload the voxels inflated by inflateBlocks and drop the blob
+void Chunk::restoreFromRaw(const std::string &raw) {
+    std::istringstream in(raw, std::ios::binary);
+    loadFromStream(in);
+
+    cold->compressedBlocks.clear();
+    cold->compressedBlocks.shrink_to_fit();
+    compressed = false;
 }
@@ -0,0 +1,491 @@
+#include "ChunkCuller.hpp"
+#include "Chunk.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CHUNK_CULLER_SSE 1
+#endif
+
+namespace {
+// Face order of writeQuad: +Z, -Z, +Y, -Y, +X, -X
+constexpr int OPPOSITE_FACE[6] = { 1, 0, 3, 2, 5, 4 };
+constexpr int FACE_STEP[6][3] = { {0, 0, 1}, {0, 0, -1}, {0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {-1, 0, 0} };
+
+bool boxInFrustum(const glm::vec4 (&planes)[6], const glm::vec3 &center, const glm::vec3 &extent) {
+	for (const glm::vec4 &plane : planes) {
+		const float distance = plane.x * center.x + plane.w + plane.y * center.y + plane.z * center.z
+			+ std::abs(plane.x) * extent.x + std::abs(plane.y) * extent.y + std::abs(plane.z) * extent.z;
+		if (distance < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+int floorDiv(const int value, const int divisor) {
+	return value >= 0 ? value / divisor : (value - divisor + 1) / divisor;
+}
+
+// Angle of (x, z) around the Y axis mapped to [0, 4) without atan2.  It grows
+// with the angle and a half turn adds 2, which is all the horizon needs.
+float diamondAngle(const float x, const float z) {
+	if (z >= 0.0f)
+		return x >= 0.0f ? z / (x + z) : 1.0f - x / (z - x);
+	return x < 0.0f ? 2.0f - z / (-x - z) : 3.0f + x / (x - z);
+}
+
+// Distances and angle range of the footprint [min, max] seen from the
+// camera, false when the camera is over it
+bool footprintSpan(const glm::vec3 &cameraPos, const glm::vec2 &min, const glm::vec2 &max, float &nearest,
+                   float &farthest, float &firstAngle, float &lastAngle) {
+	const float nearX = std::max({ min.x - cameraPos.x, cameraPos.x - max.x, 0.0f });
+	const float nearZ = std::max({ min.y - cameraPos.z, cameraPos.z - max.y, 0.0f });
+	nearest = std::sqrt(nearX * nearX + nearZ * nearZ);
+	if (nearest <= 0.0f)
+		return false;
+	const float farX = std::max(std::abs(cameraPos.x - min.x), std::abs(cameraPos.x - max.x));
+	const float farZ = std::max(std::abs(cameraPos.z - min.y), std::abs(cameraPos.z - max.y));
+	farthest = std::sqrt(farX * farX + farZ * farZ);
+
+	// The footprint spans less than a half turn, so the corners are within
+	// 2 of the angle of its centre
+	const float center = diamondAngle((min.x + max.x) * 0.5f - cameraPos.x, (min.y + max.y) * 0.5f - cameraPos.z);
+	float low = 0.0f, high = 0.0f;
+	for (int corner = 0; corner < 4; ++corner) {
+		float delta = diamondAngle((corner & 1 ? max.x : min.x) - cameraPos.x,
+		                           (corner & 2 ? max.y : min.y) - cameraPos.z) - center;
+		if (delta > 2.0f)
+			delta -= 4.0f;
+		else if (delta < -2.0f)
+			delta += 4.0f;
+		low = std::min(low, delta);
+		high = std::max(high, delta);
+	}
+	firstAngle = center + low;
+	lastAngle = center + high;
+	return true;
+}
+}
+
+void ChunkCuller::setChunks(const std::vector<std::weak_ptr<Chunk>> &renderedChunks) {
+	chunks.clear();
+	centerX.clear();
+	centerY.clear();
+	centerZ.clear();
+	extentX.clear();
+	extentY.clear();
+	extentZ.clear();
+	connectivity.clear();
+	occluders.clear();
+
+	// Grid over the loaded columns for the section walk
+	int minX = 0, minZ = 0, maxX = -1, maxZ = -1;
+	for (const auto &weak : renderedChunks) {
+		if (auto chunk = weak.lock()) {
+			const glm::ivec3 origin = chunk->getGlobalCoords();
+			const int x = floorDiv(origin.x, Chunk::WIDTH);
+			const int z = floorDiv(origin.z, Chunk::DEPTH);
+			if (maxX < minX) {
+				minX = maxX = x;
+				minZ = maxZ = z;
+			}
+			minX = std::min(minX, x);
+			maxX = std::max(maxX, x);
+			minZ = std::min(minZ, z);
+			maxZ = std::max(maxZ, z);
+		}
+	}
+	gridMinX = minX;
+	gridMinZ = minZ;
+	gridWidth = maxX - minX + 1;
+	gridDepth = maxZ - minZ + 1;
+	grid.assign(static_cast<std::size_t>(gridWidth) * gridDepth, NO_COLUMN);
+	sectionVisits.assign(grid.size() * Chunk::SECTION_COUNT, 0);
+	visitStamp = 0;
+
+	for (const auto &weak : renderedChunks) {
+		auto chunk = weak.lock();
+		if (!chunk)
+			continue;
+		const glm::ivec3 origin = chunk->getGlobalCoords();
+		int32_t &column = grid[(floorDiv(origin.x, Chunk::WIDTH) - gridMinX)
+		                       + gridWidth * (floorDiv(origin.z, Chunk::DEPTH) - gridMinZ)];
+		if (chunk->getMeshMaxY() < chunk->getMeshMinY()) {
+			column = EMPTY_COLUMN;
+			continue;
+		}
+		column = static_cast<int32_t>(chunks.size());
+		chunks.push_back(weak);
+		centerX.push_back(origin.x + Chunk::WIDTH * 0.5f);
+		centerY.push_back(0.0f);
+		centerZ.push_back(origin.z + Chunk::DEPTH * 0.5f);
+		extentX.push_back(Chunk::WIDTH * 0.5f);
+		extentY.push_back(0.0f);
+		extentZ.push_back(Chunk::DEPTH * 0.5f);
+		connectivity.resize(connectivity.size() + Chunk::SECTION_COUNT);
+		occluders.resize(occluders.size() + Chunk::OCCLUDER_CELLS * Chunk::OCCLUDER_CELLS);
+		readMesh(static_cast<std::size_t>(column), *chunk);
+	}
+	firstSections.assign(chunks.size(), 0);
+	// Indices of the previous table mean nothing anymore
+	++tableVersion;
+	visibleIndices.clear();
+	visibleChunks.clear();
+	++visibleVersion;
+}
+
+// Chunks keep their table index, so the walk, the sort and the occlusion
+// result of the table stay valid
+bool ChunkCuller::updateChunks(const std::vector<std::shared_ptr<Chunk>> &changed) {
+	for (const std::shared_ptr<Chunk> &chunk : changed) {
+		const glm::ivec3 origin = chunk->getGlobalCoords();
+		const int x = floorDiv(origin.x, Chunk::WIDTH) - gridMinX;
+		const int z = floorDiv(origin.z, Chunk::DEPTH) - gridMinZ;
+		if (x < 0 || z < 0 || x >= gridWidth || z >= gridDepth)
+			continue; // not rendered
+		const int32_t column = grid[x + gridWidth * z];
+		const bool empty = chunk->getMeshMaxY() < chunk->getMeshMinY();
+		if (column == NO_COLUMN || (column == EMPTY_COLUMN && empty))
+			continue;
+		if (column == EMPTY_COLUMN || empty)
+			return false;
+		// Another chunk of the same column is waiting for the next table
+		if (chunks[column].lock() != chunk)
+			continue;
+		readMesh(static_cast<std::size_t>(column), *chunk);
+	}
+	return true;
+}
+
+void ChunkCuller::readMesh(const std::size_t index, const Chunk &chunk) {
+	for (int section = 0; section < Chunk::SECTION_COUNT; ++section)
+		connectivity[index * Chunk::SECTION_COUNT + section] = chunk.getSectionConnectivity(section);
+	std::size_t cell = index * Chunk::OCCLUDER_CELLS * Chunk::OCCLUDER_CELLS;
+	for (int cellZ = 0; cellZ < Chunk::OCCLUDER_CELLS; ++cellZ)
+		for (int cellX = 0; cellX < Chunk::OCCLUDER_CELLS; ++cellX)
+			occluders[cell++] = chunk.getOccluder(cellX, cellZ);
+	const float minY = static_cast<float>(chunk.getMeshMinY());
+	const float maxY = static_cast<float>(chunk.getMeshMaxY() + 1);
+	centerY[index] = (minY + maxY) * 0.5f;
+	extentY[index] = (maxY - minY) * 0.5f;
+}
+
+const std::vector<ChunkRenderer::VisibleChunk> &ChunkCuller::cull(const glm::mat4 &viewProjection,
+                                                                 const glm::vec3 &cameraPos) {
+	// Planes a.x + b.y + c.z + d >= 0 inside (Gribb & Hartmann), from the rows
+	// of the matrix.  No need to normalize them for a sign test.
+	const glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+	const glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+	const glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+	const glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+	const glm::vec4 planes[6] = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2 };
+	testFrustum(planes);
+	// Without the walk every chunk in the frustum is drawn whole
+	if (!caveCulling || !walkSections(planes, cameraPos))
+		std::fill(firstSections.begin(), firstSections.end(), 0);
+
+	// Squared distance from the camera to the nearest point of each box
+	sortedIndices.clear();
+	for (const uint32_t i : insideIndices) {
+		if (firstSections[i] == Chunk::SECTION_COUNT)
+			continue;
+		const float dx = std::max(std::abs(cameraPos.x - centerX[i]) - extentX[i], 0.0f);
+		const float dy = std::max(std::abs(cameraPos.y - centerY[i]) - extentY[i], 0.0f);
+		const float dz = std::max(std::abs(cameraPos.z - centerZ[i]) - extentZ[i], 0.0f);
+		sortedIndices.emplace_back(dx * dx + dy * dy + dz * dz, i);
+	}
+	std::sort(sortedIndices.begin(), sortedIndices.end());
+	caveHidden = insideIndices.size() - sortedIndices.size();
+	horizonHidden = 0;
+	if (horizonCulling)
+		cullBelowHorizon(cameraPos);
+
+	// Hide what the job started by the previous cull found hidden, as long
+	// as the camera stayed close to the view it tested, then test this view
+	// while the frame is drawn
+	if (occlusionJob.valid() && occlusionJob.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+		occlusion = occlusionJob.get();
+	const glm::vec3 moved = cameraPos - occlusion.cameraPos;
+	const bool applyOcclusion = occlusionCulling && occlusion.tableVersion == tableVersion
+		&& occlusion.hidden.size() == chunks.size()
+		&& glm::dot(moved, moved) <= MAX_OCCLUSION_MOVE * MAX_OCCLUSION_MOVE
+		&& glm::dot(viewDirection(viewProjection), occlusion.viewDir) >= MIN_OCCLUSION_TURN_COS;
+	if (occlusionCulling && !occlusionJob.valid())
+		startOcclusionJob(viewProjection, cameraPos);
+	occlusionHidden = 0;
+	if (applyOcclusion) {
+		const auto hidden = [this](const std::pair<float, uint32_t> &sorted) { return occlusion.hidden[sorted.second] != 0; };
+		const auto kept = std::remove_if(sortedIndices.begin(), sortedIndices.end(), hidden);
+		occlusionHidden = static_cast<std::size_t>(sortedIndices.end() - kept);
+		sortedIndices.erase(kept, sortedIndices.end());
+	}
+
+	// The renderer rebuilds its draw commands when the version changes, so
+	// keep it while the visible chunks, their order and sections stay the same
+	const bool same = sortedIndices.size() == visibleIndices.size()
+		&& std::equal(sortedIndices.begin(), sortedIndices.end(), visibleIndices.begin(),
+		              [this](const std::pair<float, uint32_t> &sorted, const std::pair<uint32_t, int> &visible) {
+			              return sorted.second == visible.first && firstSections[sorted.second] == visible.second;
+		              });
+	if (same)
+		return visibleChunks;
+
+	visibleIndices.clear();
+	visibleChunks.clear();
+	for (const auto &sorted : sortedIndices) {
+		const int firstSection = firstSections[sorted.second];
+		visibleIndices.emplace_back(sorted.second, firstSection);
+		visibleChunks.push_back({ chunks[sorted.second], firstSection });
+	}
+	++visibleVersion;
+	return visibleChunks;
+}
+
+// A box is outside when it is fully behind one plane, that is when
+// dot(normal, centre) + d + dot(|normal|, extent) < 0.  Fills insideIndices.
+void ChunkCuller::testFrustum(const glm::vec4 (&planes)[6]) {
+	insideIndices.clear();
+	const uint32_t count = static_cast<uint32_t>(chunks.size());
+	uint32_t i = 0;
+
+#ifdef CHUNK_CULLER_SSE
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4) {
+		const __m128 cx = _mm_loadu_ps(&centerX[i]);
+		const __m128 cy = _mm_loadu_ps(&centerY[i]);
+		const __m128 cz = _mm_loadu_ps(&centerZ[i]);
+		const __m128 ex = _mm_loadu_ps(&extentX[i]);
+		const __m128 ey = _mm_loadu_ps(&extentY[i]);
+		const __m128 ez = _mm_loadu_ps(&extentZ[i]);
+		__m128 outside = zero;
+		for (const glm::vec4 &plane : planes) {
+			__m128 distance = _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane.x)), _mm_set1_ps(plane.w));
+			distance = _mm_add_ps(distance, _mm_mul_ps(cy, _mm_set1_ps(plane.y)));
+			distance = _mm_add_ps(distance, _mm_mul_ps(cz, _mm_set1_ps(plane.z)));
+			distance = _mm_add_ps(distance, _mm_mul_ps(ex, _mm_set1_ps(std::abs(plane.x))));
+			distance = _mm_add_ps(distance, _mm_mul_ps(ey, _mm_set1_ps(std::abs(plane.y))));
+			distance = _mm_add_ps(distance, _mm_mul_ps(ez, _mm_set1_ps(std::abs(plane.z))));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+		}
+		const int outsideMask = _mm_movemask_ps(outside);
+		for (uint32_t lane = 0; lane < 4; ++lane) {
+			if (!(outsideMask & (1 << lane)))
+				insideIndices.push_back(i + lane);
+		}
+	}
+#endif
+
+	for (; i < count; ++i) {
+		if (boxInFrustum(planes, glm::vec3(centerX[i], centerY[i], centerZ[i]),
+		                 glm::vec3(extentX[i], extentY[i], extentZ[i])))
+			insideIndices.push_back(i);
+	}
+}
+
+// Breadth first from the camera section, filling firstSections.  False when
+// the camera column is not loaded.
+bool ChunkCuller::walkSections(const glm::vec4 (&planes)[6], const glm::vec3 &cameraPos) {
+	const int cameraX = floorDiv(static_cast<int>(std::floor(cameraPos.x)), Chunk::WIDTH) - gridMinX;
+	const int cameraZ = floorDiv(static_cast<int>(std::floor(cameraPos.z)), Chunk::DEPTH) - gridMinZ;
+	if (cameraX < 0 || cameraX >= gridWidth || cameraZ < 0 || cameraZ >= gridDepth
+		|| grid[cameraX + gridWidth * cameraZ] == NO_COLUMN)
+		return false;
+	const int cameraY = std::clamp(static_cast<int>(std::floor(cameraPos.y)) / Chunk::SECTION_HEIGHT, 0,
+	                               Chunk::SECTION_COUNT - 1);
+
+	std::fill(firstSections.begin(), firstSections.end(), Chunk::SECTION_COUNT);
+	if (++visitStamp == 0) {
+		std::fill(sectionVisits.begin(), sectionVisits.end(), 0);
+		visitStamp = 1;
+	}
+	auto visit = [&](const int x, const int y, const int z) {
+		const int column = x + gridWidth * z;
+		sectionVisits[static_cast<std::size_t>(column) * Chunk::SECTION_COUNT + y] = visitStamp;
+		if (grid[column] >= 0)
+			firstSections[grid[column]] = std::min(firstSections[grid[column]], y);
+	};
+
+	walkQueue.clear();
+	walkQueue.push_back({ cameraX, cameraY, cameraZ, -1, 0 });
+	visit(cameraX, cameraY, cameraZ);
+	const glm::vec3 sectionExtent(Chunk::WIDTH * 0.5f, Chunk::SECTION_HEIGHT * 0.5f, Chunk::DEPTH * 0.5f);
+	for (std::size_t head = 0; head < walkQueue.size(); ++head) {
+		const SectionNode node = walkQueue[head];
+		const int32_t entry = grid[node.x + gridWidth * node.z];
+		const uint16_t sectionConnectivity = entry >= 0
+			? connectivity[static_cast<std::size_t>(entry) * Chunk::SECTION_COUNT + node.y]
+			: Chunk::ALL_SECTION_FACES_CONNECTED;
+
+		for (int face = 0; face < 6; ++face) {
+			if (node.directions & (1 << OPPOSITE_FACE[face]))
+				continue;
+			if (node.entryFace >= 0 && !(sectionConnectivity >> Chunk::connectivityBit(node.entryFace, face) & 1))
+				continue;
+			const int x = node.x + FACE_STEP[face][0];
+			const int y = node.y + FACE_STEP[face][1];
+			const int z = node.z + FACE_STEP[face][2];
+			if (x < 0 || x >= gridWidth || z < 0 || z >= gridDepth || y < 0 || y >= Chunk::SECTION_COUNT)
+				continue;
+			const int column = x + gridWidth * z;
+			if (grid[column] == NO_COLUMN
+				|| sectionVisits[static_cast<std::size_t>(column) * Chunk::SECTION_COUNT + y] == visitStamp)
+				continue;
+			const glm::vec3 center((gridMinX + x) * Chunk::WIDTH + sectionExtent.x,
+			                       y * Chunk::SECTION_HEIGHT + sectionExtent.y,
+			                       (gridMinZ + z) * Chunk::DEPTH + sectionExtent.z);
+			if (!boxInFrustum(planes, center, sectionExtent))
+				continue;
+			visit(x, y, z);
+			walkQueue.push_back({ x, y, z, OPPOSITE_FACE[face],
+			                      static_cast<uint8_t>(node.directions | (1 << face)) });
+		}
+	}
+	return true;
+}
+
+// Slopes are (height - camera height) / horizontal distance, taken where
+// they are lowest over a cell footprint and highest over a chunk one.  A
+// chunk is only tested against the cells that end nearer than it starts:
+// both lists are sorted by distance and walked together.  Bins the cell
+// covers in full are raised, a chunk is hidden when all the bins it touches
+// are above it.
+void ChunkCuller::cullBelowHorizon(const glm::vec3 &cameraPos) {
+	constexpr int cellCount = Chunk::OCCLUDER_CELLS * Chunk::OCCLUDER_CELLS;
+	constexpr float binsPerAngle = HORIZON_BINS / 4.0f;
+	const glm::vec2 cellSize(static_cast<float>(Chunk::WIDTH) / Chunk::OCCLUDER_CELLS,
+	                         static_cast<float>(Chunk::DEPTH) / Chunk::OCCLUDER_CELLS);
+
+	// Under the ground the terrain is no height field anymore, the section
+	// walk deals with the caves
+	const int cameraX = static_cast<int>(std::floor(cameraPos.x));
+	const int cameraZ = static_cast<int>(std::floor(cameraPos.z));
+	const int gridX = floorDiv(cameraX, Chunk::WIDTH) - gridMinX;
+	const int gridZ = floorDiv(cameraZ, Chunk::DEPTH) - gridMinZ;
+	if (gridX >= 0 && gridX < gridWidth && gridZ >= 0 && gridZ < gridDepth && grid[gridX + gridWidth * gridZ] >= 0) {
+		const int cellX = (cameraX - floorDiv(cameraX, Chunk::WIDTH) * Chunk::WIDTH) / static_cast<int>(cellSize.x);
+		const int cellZ = (cameraZ - floorDiv(cameraZ, Chunk::DEPTH) * Chunk::DEPTH) / static_cast<int>(cellSize.y);
+		const ChunkMeshData::SolidRange &range = occluders[static_cast<std::size_t>(grid[gridX + gridWidth * gridZ])
+			* cellCount + cellX + Chunk::OCCLUDER_CELLS * cellZ];
+		if (range.top > range.bottom && cameraPos.y < range.top)
+			return;
+	}
+
+	horizonCells.clear();
+	horizonChunks.clear();
+	for (std::size_t n = 0; n < sortedIndices.size(); ++n) {
+		const uint32_t i = sortedIndices[n].second;
+		const glm::vec2 min(centerX[i] - extentX[i], centerZ[i] - extentZ[i]);
+		HorizonSpan span;
+		if (footprintSpan(cameraPos, min, min + glm::vec2(Chunk::WIDTH, Chunk::DEPTH), span.nearest, span.farthest,
+		                  span.firstAngle, span.lastAngle)) {
+			const float top = centerY[i] + extentY[i] - cameraPos.y;
+			span.slope = top / (top > 0.0f ? span.nearest : span.farthest);
+			span.position = static_cast<uint32_t>(n);
+			horizonChunks.push_back(span);
+		}
+		for (int cell = 0; cell < cellCount; ++cell) {
+			const ChunkMeshData::SolidRange &range = occluders[static_cast<std::size_t>(i) * cellCount + cell];
+			if (range.top <= range.bottom)
+				continue;
+			const glm::vec2 cellMin = min + glm::vec2(cell % Chunk::OCCLUDER_CELLS, cell / Chunk::OCCLUDER_CELLS) * cellSize;
+			if (!footprintSpan(cameraPos, cellMin, cellMin + cellSize, span.nearest, span.farthest, span.firstAngle,
+			                   span.lastAngle))
+				continue;
+			const float top = range.top - cameraPos.y;
+			span.slope = top / (top > 0.0f ? span.farthest : span.nearest);
+			horizonCells.push_back(span);
+		}
+	}
+	std::sort(horizonCells.begin(), horizonCells.end(),
+	          [](const HorizonSpan &a, const HorizonSpan &b) { return a.farthest < b.farthest; });
+	std::sort(horizonChunks.begin(), horizonChunks.end(),
+	          [](const HorizonSpan &a, const HorizonSpan &b) { return a.nearest < b.nearest; });
+
+	horizon.assign(HORIZON_BINS, std::numeric_limits<float>::lowest());
+	belowHorizon.assign(sortedIndices.size(), 0);
+	std::size_t cell = 0;
+	for (const HorizonSpan &chunk : horizonChunks) {
+		for (; cell < horizonCells.size() && horizonCells[cell].farthest <= chunk.nearest; ++cell) {
+			const HorizonSpan &raised = horizonCells[cell];
+			const int last = static_cast<int>(std::floor(raised.lastAngle * binsPerAngle));
+			for (int bin = static_cast<int>(std::ceil(raised.firstAngle * binsPerAngle)); bin < last; ++bin) {
+				float &slope = horizon[bin & (HORIZON_BINS - 1)];
+				slope = std::max(slope, raised.slope);
+			}
+		}
+		bool hidden = true;
+		const int last = static_cast<int>(std::floor(chunk.lastAngle * binsPerAngle));
+		for (int bin = static_cast<int>(std::floor(chunk.firstAngle * binsPerAngle)); hidden && bin <= last; ++bin)
+			hidden = horizon[bin & (HORIZON_BINS - 1)] > chunk.slope;
+		belowHorizon[chunk.position] = hidden;
+	}
+
+	std::size_t kept = 0;
+	for (std::size_t n = 0; n < sortedIndices.size(); ++n) {
+		if (!belowHorizon[n])
+			sortedIndices[kept++] = sortedIndices[n];
+	}
+	horizonHidden = sortedIndices.size() - kept;
+	sortedIndices.resize(kept);
+}
+
+// Occluders are the solid cells of the nearest chunks in sortedIndices, and
+// every chunk of sortedIndices is tested.  The job only reads its copies and
+// the rasterizer.
+void ChunkCuller::startOcclusionJob(const glm::mat4 &viewProjection, const glm::vec3 &cameraPos) {
+	constexpr int cellCount = Chunk::OCCLUDER_CELLS * Chunk::OCCLUDER_CELLS;
+	const glm::vec2 cellSize(static_cast<float>(Chunk::WIDTH) / Chunk::OCCLUDER_CELLS,
+	                         static_cast<float>(Chunk::DEPTH) / Chunk::OCCLUDER_CELLS);
+	std::vector<Box> occluderBoxes;
+	std::vector<std::pair<uint32_t, Box>> tested;
+	tested.reserve(sortedIndices.size());
+	for (std::size_t n = 0; n < sortedIndices.size(); ++n) {
+		const uint32_t i = sortedIndices[n].second;
+		const glm::vec3 center(centerX[i], centerY[i], centerZ[i]);
+		const glm::vec3 extent(extentX[i], extentY[i], extentZ[i]);
+		tested.push_back({ i, { center - extent, center + extent } });
+		if (n >= MAX_OCCLUDER_CHUNKS)
+			continue;
+		for (int cell = 0; cell < cellCount; ++cell) {
+			const ChunkMeshData::SolidRange &range = occluders[static_cast<std::size_t>(i) * cellCount + cell];
+			if (range.top <= range.bottom)
+				continue;
+			const glm::vec3 min(center.x - extent.x + (cell % Chunk::OCCLUDER_CELLS) * cellSize.x, range.bottom,
+			                    center.z - extent.z + (cell / Chunk::OCCLUDER_CELLS) * cellSize.y);
+			occluderBoxes.push_back({ min, min + glm::vec3(cellSize.x, range.top - range.bottom, cellSize.y) });
+		}
+	}
+
+	occlusionJob = std::async(std::launch::async, [this, viewProjection, cameraPos, version = tableVersion,
+	                                               count = chunks.size(), occluderBoxes = std::move(occluderBoxes),
+	                                               tested = std::move(tested)]() {
+		const auto start = std::chrono::steady_clock::now();
+		OcclusionResult result;
+		result.tableVersion = version;
+		result.cameraPos = cameraPos;
+		result.viewDir = viewDirection(viewProjection);
+		result.hidden.assign(count, 0);
+		rasterizer.begin(viewProjection, cameraPos);
+		for (const Box &box : occluderBoxes)
+			rasterizer.drawOccluder(box.min, box.max);
+		for (const auto &[index, box] : tested) {
+			if (!rasterizer.isVisible(box.min, box.max)) {
+				result.hidden[index] = 1;
+				++result.hiddenCount;
+			}
+		}
+		result.tested = tested.size();
+		result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return result;
+	});
+}
+
+glm::vec3 ChunkCuller::viewDirection(const glm::mat4 &viewProjection) {
+	const glm::vec3 forward(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3]);
+	const float length = glm::length(forward);
+	return length > 0.0f ? forward / length : forward;
+}
@@ -0,0 +1,446 @@
+#include "ChunkRenderer.hpp"
+#include "Chunk.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+constexpr std::size_t QUAD_WORDS = 4 * Chunk::VERTEX_WORDS;
+constexpr std::size_t QUAD_BYTES = QUAD_WORDS * sizeof(uint32_t);
+}
+
+ChunkRenderer::~ChunkRenderer() {
+	if (glfwGetCurrentContext())
+		releaseGL();
+}
+
+void ChunkRenderer::releaseGL() {
+	if (vao) {
+		glDeleteVertexArrays(1, &vao);
+		vao = 0;
+	}
+	// Deleting the ring unmaps it, the staged writes are dropped with the
+	// vertex buffer
+	stagingMap = nullptr;
+	stagingMapStart = 0;
+	stagingHead = 0;
+	stagedCopies.clear();
+	GLuint *buffers[] = { &vertexBuffer, &indexBuffer, &originBuffer, &indirectBuffer, &stagingBuffer };
+	for (GLuint *buffer : buffers) {
+		if (*buffer) {
+			glDeleteBuffers(1, buffer);
+			*buffer = 0;
+		}
+	}
+	std::lock_guard<std::mutex> lock(allocationMutex);
+	capacityQuads = 0;
+	usedQuads = 0;
+	indexCapacityQuads = 0;
+	freeRanges.clear();
+	classFreeRanges.clear();
+	releasedRanges.clear();
+	pooledQuads = 0;
+	drawList = DrawList();
+	++layoutVersion;
+}
+
+void ChunkRenderer::initGL() {
+	// Base instance and multi draw indirect are both core in 4.3
+	indirect = GLAD_GL_VERSION_4_3 != 0;
+
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &indexBuffer);
+	glGenBuffers(1, &originBuffer);
+	glGenBuffers(1, &indirectBuffer);
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	if (indirect) {
+		// One origin per draw command, selected by its baseInstance
+		glBindBuffer(GL_ARRAY_BUFFER, originBuffer);
+		glVertexAttribIPointer(1, 3, GL_INT, sizeof(glm::ivec4), static_cast<void *>(nullptr));
+		glVertexAttribDivisor(1, 1);
+		glEnableVertexAttribArray(1);
+	}
+	glBindVertexArray(0);
+	grow(INITIAL_CAPACITY_QUADS);
+}
+
+// A new buffer replaces the old one, whose content is copied over on the GPU
+void ChunkRenderer::grow(const uint32_t minimumQuads) {
+	flushWrites();
+	const uint32_t oldCapacity = capacityQuads;
+	const uint32_t newCapacity = std::max({ oldCapacity * 2, oldCapacity + minimumQuads, INITIAL_CAPACITY_QUADS });
+
+	GLuint buffer = 0;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(newCapacity * QUAD_BYTES), nullptr, GL_DYNAMIC_DRAW);
+	if (vertexBuffer) {
+		glBindBuffer(GL_COPY_READ_BUFFER, vertexBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+		                    static_cast<GLsizeiptr>(oldCapacity * QUAD_BYTES));
+		glDeleteBuffers(1, &vertexBuffer);
+	}
+	vertexBuffer = buffer;
+
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glVertexAttribIPointer(0, 2, GL_UNSIGNED_INT, Chunk::VERTEX_WORDS * sizeof(uint32_t), static_cast<void *>(nullptr));
+	glEnableVertexAttribArray(0);
+	glBindVertexArray(0);
+
+	std::lock_guard<std::mutex> lock(allocationMutex);
+	freeRange(oldCapacity, newCapacity - oldCapacity);
+	capacityQuads = newCapacity;
+}
+
+// Indices of quads [0, quadCount) relative to the mesh base vertex, shared by every mesh
+void ChunkRenderer::bindIndexCapacity(const uint32_t quadCount) {
+	if (quadCount <= indexCapacityQuads)
+		return;
+
+	const uint32_t capacity = std::max(quadCount, indexCapacityQuads * 2);
+	std::vector<GLuint> indices(static_cast<std::size_t>(capacity) * 6);
+	for (uint32_t q = 0; q < capacity; ++q) {
+		const GLuint base = q * 4;
+		const GLuint quad[6] = { base, base + 1, base + 2, base + 2, base + 3, base };
+		std::copy(quad, quad + 6, &indices[static_cast<std::size_t>(q) * 6]);
+	}
+	glBindVertexArray(vao);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+	glBindVertexArray(0);
+	indexCapacityQuads = capacity;
+}
+
+void ChunkRenderer::reserve(Allocation &allocation, const uint32_t quadCount) {
+	++layoutVersion;
+	const uint32_t rangeQuads = quadCount != 0 ? classQuads(sizeClass(quadCount)) : 0;
+	if (quadCount != 0 && allocation.quadCount == rangeQuads)
+		return;
+	release(allocation);
+	if (quadCount == 0)
+		return;
+
+	if (!vao)
+		initGL();
+	bindIndexCapacity(quadCount);
+	collectReleased();
+	uint32_t firstQuad = 0;
+	bool allocated;
+	{
+		std::lock_guard<std::mutex> lock(allocationMutex);
+		++reservedRanges;
+		allocated = allocateRange(rangeQuads, firstQuad);
+		if (!allocated) {
+			returnPooledRanges();
+			allocated = allocateRange(rangeQuads, firstQuad);
+		}
+	}
+	if (!allocated) {
+		grow(rangeQuads);
+		std::lock_guard<std::mutex> lock(allocationMutex);
+		allocateRange(rangeQuads, firstQuad);
+	}
+	allocation.firstQuad = firstQuad;
+	allocation.quadCount = rangeQuads;
+}
+
+void ChunkRenderer::release(Allocation &allocation) {
+	if (allocation.quadCount == 0)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(allocationMutex);
+		if (capacityQuads != 0) // else the buffer is gone with releaseGL
+			releasedRanges.push_back(allocation);
+	}
+	allocation = Allocation();
+	++layoutVersion;
+}
+
+// Four classes per power of two from MIN_CLASS_QUADS, a range wastes less
+// than a fifth of itself
+uint32_t ChunkRenderer::sizeClass(const uint32_t quadCount) {
+	uint32_t octave = 0;
+	while ((MIN_CLASS_QUADS * 2) << octave < quadCount)
+		++octave;
+	const uint32_t base = MIN_CLASS_QUADS << octave;
+	const uint32_t step = base / 4;
+	return octave * 4 + (quadCount > base ? (quadCount - base + step - 1) / step : 0);
+}
+
+uint32_t ChunkRenderer::classQuads(const uint32_t sizeClass) {
+	return (MIN_CLASS_QUADS / 4 * (4 + sizeClass % 4)) << (sizeClass / 4);
+}
+
+// Main thread, the ranges released since the last call join their class
+void ChunkRenderer::collectReleased() {
+	std::lock_guard<std::mutex> lock(allocationMutex);
+	for (const Allocation &range : releasedRanges) {
+		const uint32_t rangeClass = sizeClass(range.quadCount);
+		if (rangeClass >= classFreeRanges.size())
+			classFreeRanges.resize(rangeClass + 1);
+		classFreeRanges[rangeClass].push_back(range.firstQuad);
+		usedQuads -= range.quadCount;
+		pooledQuads += range.quadCount;
+	}
+	releasedRanges.clear();
+}
+
+// Pooled ranges go back to the free space, where they merge with their
+// neighbours.  allocationMutex held.
+void ChunkRenderer::returnPooledRanges() {
+	for (uint32_t rangeClass = 0; rangeClass < classFreeRanges.size(); ++rangeClass) {
+		for (const uint32_t firstQuad : classFreeRanges[rangeClass])
+			freeRange(firstQuad, classQuads(rangeClass));
+		classFreeRanges[rangeClass].clear();
+	}
+	pooledQuads = 0;
+}
+
+void ChunkRenderer::write(const Allocation &allocation, const std::size_t wordOffset, const uint32_t *words,
+                          const std::size_t wordCount) {
+	if (wordCount == 0)
+		return;
+	const std::size_t bytes = wordCount * sizeof(uint32_t);
+	const GLintptr destination = static_cast<GLintptr>(allocation.firstQuad * QUAD_BYTES + wordOffset * sizeof(uint32_t));
+
+	// A wrap gives the ring new storage, the GPU keeps the old one until
+	// the copies reading it are done
+	if (bytes <= STAGING_RING_BYTES && stagingHead + bytes > STAGING_RING_BYTES) {
+		flushWrites();
+		glBindBuffer(GL_COPY_READ_BUFFER, stagingBuffer);
+		glBufferData(GL_COPY_READ_BUFFER, static_cast<GLsizeiptr>(STAGING_RING_BYTES), nullptr, GL_STREAM_DRAW);
+		stagingHead = 0;
+	}
+	if (bytes > STAGING_RING_BYTES || (!stagingMap && !mapStagingRing())) {
+		flushWrites();
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		glBufferSubData(GL_ARRAY_BUFFER, destination, static_cast<GLsizeiptr>(bytes), words);
+		return;
+	}
+
+	std::memcpy(stagingMap + (stagingHead - stagingMapStart), words, bytes);
+	const GLintptr source = static_cast<GLintptr>(stagingHead);
+	stagingHead += bytes;
+	// The runs of one mesh follow each other in both buffers
+	if (!stagedCopies.empty() && stagedCopies.back().source + stagedCopies.back().bytes == source
+		&& stagedCopies.back().destination + stagedCopies.back().bytes == destination)
+		stagedCopies.back().bytes += static_cast<GLsizeiptr>(bytes);
+	else
+		stagedCopies.push_back({ source, destination, static_cast<GLsizeiptr>(bytes) });
+}
+
+// Maps the rest of the ring, nothing there is read by pending GPU copies
+bool ChunkRenderer::mapStagingRing() {
+	if (!stagingBuffer) {
+		glGenBuffers(1, &stagingBuffer);
+		glBindBuffer(GL_COPY_READ_BUFFER, stagingBuffer);
+		glBufferData(GL_COPY_READ_BUFFER, static_cast<GLsizeiptr>(STAGING_RING_BYTES), nullptr, GL_STREAM_DRAW);
+		stagingHead = 0;
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, stagingBuffer);
+	stagingMap = static_cast<uint8_t *>(glMapBufferRange(
+		GL_COPY_READ_BUFFER, static_cast<GLintptr>(stagingHead), static_cast<GLsizeiptr>(STAGING_RING_BYTES - stagingHead),
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT));
+	stagingMapStart = stagingHead;
+	return stagingMap != nullptr;
+}
+
+void ChunkRenderer::flushWrites() {
+	if (!stagingMap)
+		return;
+	glBindBuffer(GL_COPY_READ_BUFFER, stagingBuffer);
+	glFlushMappedBufferRange(GL_COPY_READ_BUFFER, 0, static_cast<GLsizeiptr>(stagingHead - stagingMapStart));
+	glUnmapBuffer(GL_COPY_READ_BUFFER);
+	stagingMap = nullptr;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+	for (const StagedCopy &copy : stagedCopies)
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, copy.source, copy.destination, copy.bytes);
+	stagedCopies.clear();
+}
+
+// The copy is queued behind the staged writes, so later writes to the range
+// or its release do not change what is read back.  Reading the vertex buffer
+// itself would stall until the GPU caught up with the frame.
+void ChunkRenderer::startRead(const Allocation &allocation, const std::size_t wordCount, Readback &readback) {
+	cancelRead(readback);
+	if (wordCount == 0 || allocation.quadCount == 0)
+		return;
+	flushWrites();
+	const GLsizeiptr bytes = static_cast<GLsizeiptr>(wordCount * sizeof(uint32_t));
+	glGenBuffers(1, &readback.buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, readback.buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STREAM_READ);
+	glBindBuffer(GL_COPY_READ_BUFFER, vertexBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+	                    static_cast<GLintptr>(allocation.firstQuad * QUAD_BYTES), 0, bytes);
+	readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	readback.wordCount = wordCount;
+}
+
+bool ChunkRenderer::finishRead(Readback &readback, std::vector<uint32_t> &out) {
+	if (!readback.buffer)
+		return false;
+	const GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		return false;
+
+	const GLsizeiptr bytes = static_cast<GLsizeiptr>(readback.wordCount * sizeof(uint32_t));
+	out.resize(readback.wordCount);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, readback.buffer);
+	if (const void *mapped = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bytes, GL_MAP_READ_BIT)) {
+		std::memcpy(out.data(), mapped, static_cast<std::size_t>(bytes));
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+	} else
+		glGetBufferSubData(GL_COPY_WRITE_BUFFER, 0, bytes, out.data());
+	cancelRead(readback);
+	return true;
+}
+
+void ChunkRenderer::cancelRead(Readback &readback) {
+	if (readback.fence)
+		glDeleteSync(readback.fence);
+	if (readback.buffer)
+		glDeleteBuffers(1, &readback.buffer);
+	readback = Readback();
+}
+
+// A range of the class if one is pooled, else first fit and the rest of the
+// range stays free.  quadCount is a class size.  allocationMutex held.
+bool ChunkRenderer::allocateRange(const uint32_t quadCount, uint32_t &firstQuad) {
+	const uint32_t rangeClass = sizeClass(quadCount);
+	if (rangeClass < classFreeRanges.size() && !classFreeRanges[rangeClass].empty()) {
+		firstQuad = classFreeRanges[rangeClass].back();
+		classFreeRanges[rangeClass].pop_back();
+		pooledQuads -= quadCount;
+		usedQuads += quadCount;
+		++pooledReuses;
+		return true;
+	}
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+		if (it->second < quadCount)
+			continue;
+		firstQuad = it->first;
+		const uint32_t rest = it->second - quadCount;
+		freeRanges.erase(it);
+		if (rest != 0)
+			freeRanges.emplace(firstQuad + quadCount, rest);
+		usedQuads += quadCount;
+		return true;
+	}
+	return false;
+}
+
+// Merged with the free ranges right before and after.  allocationMutex held.
+void ChunkRenderer::freeRange(const uint32_t firstQuad, uint32_t quadCount) {
+	if (quadCount == 0)
+		return;
+	auto next = freeRanges.lower_bound(firstQuad);
+	if (next != freeRanges.end() && firstQuad + quadCount == next->first) {
+		quadCount += next->second;
+		next = freeRanges.erase(next);
+	}
+	if (next != freeRanges.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == firstQuad) {
+			prev->second += quadCount;
+			return;
+		}
+	}
+	freeRanges.emplace_hint(next, firstQuad, quadCount);
+}
+
+void ChunkRenderer::draw(const std::vector<VisibleChunk> &chunks, const uint64_t listVersion,
+                         const glm::vec3 &cameraPos) {
+	drawCalls = 0;
+	if (!vao)
+		return;
+	flushWrites();
+	collectReleased();
+
+	// Which face directions of a chunk face the camera only changes when the
+	// camera moves to another chunk column or block layer
+	const glm::ivec3 cameraCell(static_cast<int>(std::floor(cameraPos.x / Chunk::WIDTH)),
+	                            static_cast<int>(std::floor(cameraPos.y)),
+	                            static_cast<int>(std::floor(cameraPos.z / Chunk::DEPTH)));
+	const uint64_t layout = layoutVersion.load();
+	if (listVersion != drawnListVersion || layout != drawnLayoutVersion || cameraCell != drawnCell) {
+		rebuildDrawList(chunks, cameraCell);
+		drawnListVersion = listVersion;
+		drawnLayoutVersion = layout;
+		drawnCell = cameraCell;
+	}
+	if (drawList.commands.empty())
+		return;
+
+	glBindVertexArray(vao);
+	if (indirect) {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr,
+		                            static_cast<GLsizei>(drawList.commands.size()), 0);
+		drawCalls = 1;
+	} else {
+		for (std::size_t i = 0; i < chunkCommands.size(); ++i) {
+			const glm::ivec4 &origin = drawList.origins[i];
+			const auto [first, count] = chunkCommands[i];
+			glVertexAttribI4i(1, origin.x, origin.y, origin.z, 0);
+			glMultiDrawElementsBaseVertex(GL_TRIANGLES, &counts[first], GL_UNSIGNED_INT, &offsets[first],
+			                              static_cast<GLsizei>(count), &baseVertices[first]);
+		}
+		drawCalls = chunkCommands.size();
+	}
+	glBindVertexArray(0);
+}
+
+void ChunkRenderer::rebuildDrawList(const std::vector<VisibleChunk> &chunks, const glm::ivec3 &cameraCell) {
+	drawList.commands.clear();
+	drawList.origins.clear();
+	chunkCommands.clear();
+	for (const VisibleChunk &visible : chunks) {
+		if (auto chunk = visible.chunk.lock()) {
+			const std::size_t first = drawList.commands.size();
+			chunk->appendDrawCommands(drawList, cameraCell, visible.firstSection);
+			if (drawList.commands.size() != first)
+				chunkCommands.emplace_back(first, drawList.commands.size() - first);
+		}
+	}
+
+	if (indirect) {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, drawList.commands.size() * sizeof(DrawCommand),
+		             drawList.commands.data(), GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, originBuffer);
+		glBufferData(GL_ARRAY_BUFFER, drawList.origins.size() * sizeof(glm::ivec4), drawList.origins.data(),
+		             GL_DYNAMIC_DRAW);
+		return;
+	}
+	counts.clear();
+	offsets.clear();
+	baseVertices.clear();
+	for (const DrawCommand &command : drawList.commands) {
+		counts.push_back(static_cast<GLsizei>(command.count));
+		offsets.push_back(reinterpret_cast<const void *>(static_cast<std::uintptr_t>(command.firstIndex) * sizeof(GLuint)));
+		baseVertices.push_back(command.baseVertex);
+	}
+}
+
+std::size_t ChunkRenderer::getBufferBytes() const {
+	std::lock_guard<std::mutex> lock(allocationMutex);
+	return capacityQuads * QUAD_BYTES;
+}
+
+std::size_t ChunkRenderer::getUsedBytes() const {
+	std::lock_guard<std::mutex> lock(allocationMutex);
+	return usedQuads * QUAD_BYTES;
+}
+
+std::size_t ChunkRenderer::getPooledBytes() const {
+	std::lock_guard<std::mutex> lock(allocationMutex);
+	return pooledQuads * QUAD_BYTES;
+}
+
+float ChunkRenderer::getPoolHitRate() const {
+	std::lock_guard<std::mutex> lock(allocationMutex);
+	return reservedRanges ? static_cast<float>(pooledReuses) / reservedRanges : 0.0f;
+}
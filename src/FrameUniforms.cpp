@@ -0,0 +1,30 @@
+#include "FrameUniforms.hpp"
+#include "Shader.hpp"
+
+#include <GLFW/glfw3.h>
+
+FrameUniforms::~FrameUniforms() {
+	if (glfwGetCurrentContext())
+		releaseGL();
+}
+
+void FrameUniforms::releaseGL() {
+	if (buffer) {
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+}
+
+void FrameUniforms::update(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &lightDir,
+                           const glm::vec3 &lightColor, const glm::vec3 &ambientColor) {
+	if (!buffer) {
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, Shader::FRAME_BINDING, buffer);
+	}
+	const Block block = { view, projection, glm::vec4(lightDir, 0.0f), glm::vec4(lightColor, 0.0f),
+	                      glm::vec4(ambientColor, 0.0f) };
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+}
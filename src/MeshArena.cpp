@@ -0,0 +1,73 @@
+#include "MeshArena.hpp"
+
+#include <mutex>
+
+namespace {
+// Enough for the mesh jobs World runs in one frame plus the parts of the
+// chunks meshed during it, anything above is freed
+constexpr std::size_t MAX_POOLED_ARENAS = 16;
+constexpr std::size_t MAX_POOLED_BUFFERS = 256;
+
+std::mutex poolMutex;
+std::vector<std::unique_ptr<MeshArena>> freeArenas;
+std::vector<std::vector<uint32_t>> freeBuffers;
+}
+
+MeshArena::Handle MeshArena::acquire() {
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		if (!freeArenas.empty()) {
+			MeshArena *arena = freeArenas.back().release();
+			freeArenas.pop_back();
+			return Handle(arena);
+		}
+	}
+	return Handle(new MeshArena());
+}
+
+void MeshArena::Release::operator()(MeshArena *arena) const {
+	std::lock_guard<std::mutex> lock(poolMutex);
+	if (freeArenas.size() < MAX_POOLED_ARENAS) {
+		if (freeArenas.capacity() == 0)
+			freeArenas.reserve(MAX_POOLED_ARENAS);
+		freeArenas.emplace_back(arena);
+		return;
+	}
+	delete arena;
+}
+
+std::vector<uint32_t> MeshArena::takeVertexBuffer(const std::size_t words) {
+	std::lock_guard<std::mutex> lock(poolMutex);
+	if (freeBuffers.empty())
+		return {};
+
+	std::size_t best = 0;
+	for (std::size_t i = 1; i < freeBuffers.size(); ++i) {
+		const std::size_t capacity = freeBuffers[i].capacity();
+		const std::size_t bestCapacity = freeBuffers[best].capacity();
+		const bool fits = capacity >= words;
+		const bool bestFits = bestCapacity >= words;
+		if (fits ? (!bestFits || capacity < bestCapacity) : (!bestFits && capacity > bestCapacity))
+			best = i;
+	}
+	std::vector<uint32_t> buffer = std::move(freeBuffers[best]);
+	if (best + 1 != freeBuffers.size())
+		freeBuffers[best] = std::move(freeBuffers.back());
+	freeBuffers.pop_back();
+	return buffer;
+}
+
+void MeshArena::recycleVertexBuffer(std::vector<uint32_t> &&buffer) {
+	if (buffer.capacity() == 0)
+		return;
+	buffer.clear();
+
+	std::lock_guard<std::mutex> lock(poolMutex);
+	if (freeBuffers.size() < MAX_POOLED_BUFFERS) {
+		if (freeBuffers.capacity() == 0)
+			freeBuffers.reserve(MAX_POOLED_BUFFERS);
+		freeBuffers.push_back(std::move(buffer));
+		return;
+	}
+	std::vector<uint32_t>().swap(buffer);
+}
@@ -0,0 +1,203 @@
+#include "MeshCache.hpp"
+#include "MeshArena.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+struct MeshCacheFileMetadata {
+	char magic[4] = {'M','S','H','1'};
+	std::uint32_t version = 3;
+	std::uint32_t chunkWidth = Chunk::WIDTH;
+	std::uint32_t chunkHeight = Chunk::HEIGHT;
+	std::uint32_t vertexWords = Chunk::VERTEX_WORDS;
+	std::uint32_t entryCount = 0;
+};
+
+// Per entry: chunk coordinates, built parts, interior face quads, section
+// connectivity, occluders, part hashes and sizes, then the packed vertices of each part
+struct MeshCacheFileEntry {
+	std::int32_t chunkX;
+	std::int32_t chunkZ;
+	std::uint32_t builtParts;
+	std::uint32_t interiorFaceQuads[6];
+	std::uint16_t sectionConnectivity[ChunkMeshData::SECTION_COUNT];
+	std::int16_t occluders[ChunkMeshData::OCCLUDER_CELLS * ChunkMeshData::OCCLUDER_CELLS][2];
+	std::uint64_t partHashes[ChunkMeshData::PART_COUNT];
+	std::uint32_t partWords[ChunkMeshData::PART_COUNT];
+};
+
+// Most words a part can hold: a quad per block face for the interior, a quad
+// per block of the border slice for a strip.  Larger sizes in a file are
+// corrupt.
+constexpr std::size_t QUAD_WORDS = 4 * Chunk::VERTEX_WORDS;
+constexpr std::size_t MAX_INTERIOR_WORDS = std::size_t{Chunk::WIDTH} * Chunk::HEIGHT * Chunk::DEPTH * 6 * QUAD_WORDS;
+constexpr std::size_t MAX_STRIP_WORDS = std::size_t{Chunk::WIDTH > Chunk::DEPTH ? Chunk::WIDTH : Chunk::DEPTH}
+	* Chunk::HEIGHT * QUAD_WORDS;
+
+bool validEntry(const MeshCacheFileEntry &entry) {
+	std::size_t interiorQuads = 0;
+	for (const std::uint32_t quads : entry.interiorFaceQuads)
+		interiorQuads += quads;
+	for (int part = 0; part < ChunkMeshData::PART_COUNT; ++part) {
+		const std::size_t maxWords = part == ChunkMeshData::INTERIOR ? MAX_INTERIOR_WORDS : MAX_STRIP_WORDS;
+		if (entry.partWords[part] > maxWords || entry.partWords[part] % QUAD_WORDS != 0)
+			return false;
+	}
+	return interiorQuads * QUAD_WORDS == entry.partWords[ChunkMeshData::INTERIOR];
+}
+
+std::size_t meshBytes(const ChunkMeshData &mesh) {
+	return mesh.wordCount() * sizeof(uint32_t);
+}
+}
+
+void MeshCache::store(const int chunkX, const int chunkZ, ChunkMeshData &&mesh) {
+	std::lock_guard<std::mutex> lock(mutex);
+	insert(toKey(chunkX, chunkZ), std::move(mesh));
+}
+
+bool MeshCache::take(const int chunkX, const int chunkZ, ChunkMeshData &out) {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = entries.find(toKey(chunkX, chunkZ));
+	if (it == entries.end())
+		return false;
+	out = std::move(it->second.mesh);
+	erase(it);
+	return true;
+}
+
+void MeshCache::insert(const uint64_t key, ChunkMeshData &&mesh) {
+	auto it = entries.find(key);
+	if (it != entries.end())
+		erase(it);
+
+	Entry entry;
+	entry.bytes = meshBytes(mesh);
+	entry.mesh = std::move(mesh);
+	entry.age = ages.insert(ages.end(), key);
+	bytes += entry.bytes;
+	entries.emplace(key, std::move(entry));
+
+	while (bytes > maxBytes && !ages.empty())
+		erase(entries.find(ages.front()));
+}
+
+void MeshCache::erase(const std::unordered_map<uint64_t, Entry>::iterator it) {
+	for (auto &part : it->second.mesh.parts)
+		MeshArena::recycleVertexBuffer(std::move(part));
+	bytes -= it->second.bytes;
+	ages.erase(it->second.age);
+	entries.erase(it);
+}
+
+bool MeshCache::save(const std::string &filename, const int firstX, const int firstZ, const int size) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<const std::pair<const uint64_t, Entry> *> saved;
+	for (int x = firstX; x < firstX + size; ++x) {
+		for (int z = firstZ; z < firstZ + size; ++z) {
+			auto it = entries.find(toKey(x, z));
+			if (it != entries.end())
+				saved.push_back(&*it);
+		}
+	}
+	if (saved.empty())
+		return true;
+
+	std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+	if (!out) {
+		std::cerr << "MeshCache::save: cannot open " << filename << std::endl;
+		return false;
+	}
+	MeshCacheFileMetadata metadata;
+	metadata.entryCount = static_cast<std::uint32_t>(saved.size());
+	out.write(reinterpret_cast<const char *>(&metadata), sizeof(metadata));
+
+	for (const auto *savedEntry : saved) {
+		const ChunkMeshData &mesh = savedEntry->second.mesh;
+		MeshCacheFileEntry entry;
+		entry.chunkX = static_cast<std::int32_t>(savedEntry->first >> 32);
+		entry.chunkZ = static_cast<std::int32_t>(savedEntry->first & 0xFFFFFFFFu);
+		entry.builtParts = mesh.builtParts;
+		for (int face = 0; face < 6; ++face)
+			entry.interiorFaceQuads[face] = mesh.interiorFaceQuads[face];
+		for (int section = 0; section < ChunkMeshData::SECTION_COUNT; ++section)
+			entry.sectionConnectivity[section] = mesh.sectionConnectivity[section];
+		for (std::size_t cell = 0; cell < mesh.occluders.size(); ++cell) {
+			entry.occluders[cell][0] = mesh.occluders[cell].bottom;
+			entry.occluders[cell][1] = mesh.occluders[cell].top;
+		}
+		for (int part = 0; part < ChunkMeshData::PART_COUNT; ++part) {
+			entry.partHashes[part] = mesh.partHashes[part];
+			entry.partWords[part] = static_cast<std::uint32_t>(mesh.parts[part].size());
+		}
+		out.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+		for (const auto &part : mesh.parts)
+			out.write(reinterpret_cast<const char *>(part.data()), part.size() * sizeof(uint32_t));
+	}
+	return static_cast<bool>(out);
+}
+
+bool MeshCache::load(const std::string &filename) {
+	std::ifstream in(filename, std::ios::binary);
+	if (!in)
+		return false;
+
+	MeshCacheFileMetadata metadata;
+	in.read(reinterpret_cast<char *>(&metadata), sizeof(metadata));
+	const MeshCacheFileMetadata expected;
+	if (!in || std::strncmp(metadata.magic, expected.magic, 4) != 0 || metadata.version != expected.version
+		|| metadata.chunkWidth != expected.chunkWidth || metadata.chunkHeight != expected.chunkHeight
+		|| metadata.vertexWords != expected.vertexWords)
+		return false;
+
+	for (std::uint32_t i = 0; i < metadata.entryCount; ++i) {
+		MeshCacheFileEntry entry;
+		if (!in.read(reinterpret_cast<char *>(&entry), sizeof(entry)) || !validEntry(entry)) {
+			std::cerr << "MeshCache::load: corrupt entry in " << filename << std::endl;
+			return false;
+		}
+
+		ChunkMeshData mesh;
+		mesh.builtParts = static_cast<uint8_t>(entry.builtParts);
+		for (int face = 0; face < 6; ++face)
+			mesh.interiorFaceQuads[face] = entry.interiorFaceQuads[face];
+		for (int section = 0; section < ChunkMeshData::SECTION_COUNT; ++section)
+			mesh.sectionConnectivity[section] = entry.sectionConnectivity[section];
+		for (std::size_t cell = 0; cell < mesh.occluders.size(); ++cell) {
+			mesh.occluders[cell].bottom = entry.occluders[cell][0];
+			mesh.occluders[cell].top = entry.occluders[cell][1];
+		}
+		for (int part = 0; part < ChunkMeshData::PART_COUNT; ++part) {
+			mesh.partHashes[part] = entry.partHashes[part];
+			mesh.parts[part] = MeshArena::takeVertexBuffer(entry.partWords[part]);
+			mesh.parts[part].resize(entry.partWords[part]);
+			if (!in.read(reinterpret_cast<char *>(mesh.parts[part].data()), entry.partWords[part] * sizeof(uint32_t))) {
+				std::cerr << "MeshCache::load: truncated " << filename << std::endl;
+				return false;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		insert(toKey(entry.chunkX, entry.chunkZ), std::move(mesh));
+	}
+	return true;
+}
+
+std::size_t MeshCache::getEntryCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return entries.size();
+}
+
+std::size_t MeshCache::getBytes() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return bytes;
+}
+
+void MeshCache::setMaxBytes(const std::size_t maxCacheBytes) {
+	std::lock_guard<std::mutex> lock(mutex);
+	maxBytes = maxCacheBytes;
+	while (bytes > maxBytes && !ages.empty())
+		erase(entries.find(ages.front()));
+}
@@ -0,0 +1,203 @@
+#include "OcclusionRasterizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_RASTERIZER_SSE 1
+#endif
+
+namespace {
+// Corners of each box face in order around it (writeQuad face order), bit 0
+// of a corner takes max.x, bit 1 max.y, bit 2 max.z
+constexpr int FACE_CORNERS[6][4] = {
+	{ 4, 5, 7, 6 }, // +Z
+	{ 1, 0, 2, 3 }, // -Z
+	{ 2, 6, 7, 3 }, // +Y
+	{ 0, 1, 5, 4 }, // -Y
+	{ 5, 1, 3, 7 }, // +X
+	{ 0, 4, 6, 2 }, // -X
+};
+
+glm::vec3 boxCorner(const glm::vec3 &min, const glm::vec3 &max, const int corner) {
+	return glm::vec3(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z);
+}
+}
+
+OcclusionRasterizer::OcclusionRasterizer() : depth(WIDTH * HEIGHT, 1.0f) {}
+
+void OcclusionRasterizer::begin(const glm::mat4 &matrix, const glm::vec3 &position) {
+	viewProjection = matrix;
+	cameraPos = position;
+	std::fill(depth.begin(), depth.end(), 1.0f);
+}
+
+bool OcclusionRasterizer::project(const glm::vec3 &point, glm::vec3 &out) const {
+	const glm::vec4 clip = viewProjection * glm::vec4(point, 1.0f);
+	if (clip.w < 0.1f)
+		return false;
+	const float invW = 1.0f / clip.w;
+	out = glm::vec3((clip.x * invW * 0.5f + 0.5f) * WIDTH, (clip.y * invW * 0.5f + 0.5f) * HEIGHT,
+	                clip.z * invW * 0.5f + 0.5f);
+	return true;
+}
+
+void OcclusionRasterizer::drawOccluder(const glm::vec3 &min, const glm::vec3 &max) {
+	glm::vec3 corners[8];
+	for (int corner = 0; corner < 8; ++corner) {
+		if (!project(boxCorner(min, max, corner), corners[corner]))
+			return;
+	}
+	// Boxes thinner than a pixel on screen or off it cover no whole pixel
+	float minX = corners[0].x, maxX = minX, minY = corners[0].y, maxY = minY;
+	for (int corner = 1; corner < 8; ++corner) {
+		minX = std::min(minX, corners[corner].x);
+		maxX = std::max(maxX, corners[corner].x);
+		minY = std::min(minY, corners[corner].y);
+		maxY = std::max(maxY, corners[corner].y);
+	}
+	if (maxX - minX < 1.0f || maxY - minY < 1.0f || maxX < 0.0f || minX > WIDTH || maxY < 0.0f || minY > HEIGHT)
+		return;
+	// Faces the camera is in front of
+	const bool faceVisible[6] = { cameraPos.z > max.z, cameraPos.z < min.z, cameraPos.y > max.y,
+	                              cameraPos.y < min.y, cameraPos.x > max.x, cameraPos.x < min.x };
+	for (int face = 0; face < 6; ++face) {
+		if (!faceVisible[face])
+			continue;
+		const int *quad = FACE_CORNERS[face];
+		drawTriangle(corners[quad[0]], corners[quad[1]], corners[quad[2]]);
+		drawTriangle(corners[quad[0]], corners[quad[2]], corners[quad[3]]);
+	}
+}
+
+// Half-space rasterization.  An edge function must clear half the pixel
+// footprint along its normal for the whole pixel to be inside.
+void OcclusionRasterizer::drawTriangle(const glm::vec3 &a, const glm::vec3 &b, const glm::vec3 &c) {
+	float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (std::abs(area) < 1e-6f)
+		return;
+	const glm::vec3 *v[3] = { &a, &b, &c };
+	if (area < 0.0f) {
+		std::swap(v[1], v[2]);
+		area = -area;
+	}
+
+	const int minX = std::max(0, static_cast<int>(std::floor(std::min({ a.x, b.x, c.x }))));
+	const int maxX = std::min(WIDTH - 1, static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x }))));
+	const int minY = std::max(0, static_cast<int>(std::floor(std::min({ a.y, b.y, c.y }))));
+	const int maxY = std::min(HEIGHT - 1, static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y }))));
+	if (minX > maxX || minY > maxY)
+		return;
+
+	// E(x, y) = ex * x + ey * y + e0 >= margin inside, at pixel centres
+	float ex[3], ey[3], e0[3], margin[3];
+	for (int i = 0; i < 3; ++i) {
+		const glm::vec3 &p = *v[i];
+		const glm::vec3 &q = *v[(i + 1) % 3];
+		ex[i] = p.y - q.y;
+		ey[i] = q.x - p.x;
+		e0[i] = p.x * q.y - p.y * q.x;
+		margin[i] = 0.5f * (std::abs(ex[i]) + std::abs(ey[i]));
+	}
+	// Depth plane, made the farthest value over the pixel
+	const float dzdx = ((v[1]->z - v[0]->z) * (v[2]->y - v[0]->y) - (v[2]->z - v[0]->z) * (v[1]->y - v[0]->y)) / area;
+	const float dzdy = ((v[2]->z - v[0]->z) * (v[1]->x - v[0]->x) - (v[1]->z - v[0]->z) * (v[2]->x - v[0]->x)) / area;
+	const float z0 = v[0]->z - dzdx * v[0]->x - dzdy * v[0]->y + 0.5f * (std::abs(dzdx) + std::abs(dzdy));
+
+	for (int y = minY; y <= maxY; ++y) {
+		const float py = y + 0.5f;
+		// Span of pixel centres the edges leave on this row
+		float spanMin = minX + 0.5f, spanMax = maxX + 0.5f;
+		for (int i = 0; i < 3; ++i) {
+			const float bound = (margin[i] - ey[i] * py - e0[i]);
+			if (ex[i] > 0.0f)
+				spanMin = std::max(spanMin, bound / ex[i]);
+			else if (ex[i] < 0.0f)
+				spanMax = std::min(spanMax, bound / ex[i]);
+			else if (bound > 0.0f)
+				spanMax = -1.0f;
+		}
+		if (spanMin > spanMax)
+			continue;
+		const int rowMinX = std::max(minX, static_cast<int>(std::floor(spanMin - 0.5f)));
+		const int rowMaxX = std::min(maxX, static_cast<int>(std::ceil(spanMax - 0.5f)));
+		float *row = &depth[y * WIDTH];
+		int x = rowMinX;
+#ifdef OCCLUSION_RASTERIZER_SSE
+		x = rowMinX & ~3;
+		const __m128 lane = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+		__m128 rowEdge[3], stepEdge[3], threshold[3];
+		for (int i = 0; i < 3; ++i) {
+			rowEdge[i] = _mm_set1_ps(ey[i] * py + e0[i]);
+			stepEdge[i] = _mm_set1_ps(ex[i]);
+			threshold[i] = _mm_set1_ps(margin[i]);
+		}
+		const __m128 rowDepth = _mm_set1_ps(dzdy * py + z0);
+		const __m128 stepDepth = _mm_set1_ps(dzdx);
+		const __m128 one = _mm_set1_ps(1.0f);
+		for (; x <= rowMaxX; x += 4) {
+			const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane);
+			__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(stepEdge[0], px), rowEdge[0]), threshold[0]);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(stepEdge[1], px), rowEdge[1]), threshold[1]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(stepEdge[2], px), rowEdge[2]), threshold[2]));
+			if (_mm_movemask_ps(inside) == 0)
+				continue;
+			const __m128 pixelDepth = _mm_min_ps(_mm_add_ps(_mm_mul_ps(stepDepth, px), rowDepth), one);
+			const __m128 stored = _mm_loadu_ps(row + x);
+			const __m128 written = _mm_min_ps(stored, pixelDepth);
+			_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, written), _mm_andnot_ps(inside, stored)));
+		}
+#else
+		for (; x <= rowMaxX; ++x) {
+			const float px = x + 0.5f;
+			bool inside = true;
+			for (int i = 0; i < 3; ++i)
+				inside = inside && ex[i] * px + ey[i] * py + e0[i] >= margin[i];
+			if (inside)
+				row[x] = std::min(row[x], std::min(dzdx * px + dzdy * py + z0, 1.0f));
+		}
+#endif
+	}
+}
+
+bool OcclusionRasterizer::isVisible(const glm::vec3 &min, const glm::vec3 &max) const {
+	float minX = WIDTH, maxX = 0.0f, minY = HEIGHT, maxY = 0.0f, nearest = 1.0f;
+	for (int corner = 0; corner < 8; ++corner) {
+		glm::vec3 p;
+		if (!project(boxCorner(min, max, corner), p))
+			return true; // crosses the near plane
+		minX = std::min(minX, p.x);
+		maxX = std::max(maxX, p.x);
+		minY = std::min(minY, p.y);
+		maxY = std::max(maxY, p.y);
+		nearest = std::min(nearest, p.z);
+	}
+	const int x0 = std::max(0, static_cast<int>(std::floor(minX)));
+	const int x1 = std::min(WIDTH - 1, static_cast<int>(std::floor(maxX)));
+	const int y0 = std::max(0, static_cast<int>(std::floor(minY)));
+	const int y1 = std::min(HEIGHT - 1, static_cast<int>(std::floor(maxY)));
+	if (x0 > x1 || y0 > y1)
+		return true;
+
+	// Visible as soon as one pixel is not closer than the box
+	for (int y = y0; y <= y1; ++y) {
+		const float *row = &depth[y * WIDTH];
+		int x = x0;
+#ifdef OCCLUSION_RASTERIZER_SSE
+		// Whole groups of four, reading a few pixels past the rectangle only
+		// makes the test answer visible more often
+		const __m128 boxDepth = _mm_set1_ps(nearest);
+		for (x = x0 & ~3; x <= x1; x += 4) {
+			if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth)))
+				return true;
+		}
+#else
+		for (; x <= x1; ++x) {
+			if (row[x] >= nearest)
+				return true;
+		}
+#endif
+	}
+	return false;
+}
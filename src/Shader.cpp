@@ -25,20 +25,66 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
 
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+
+    reflectUniforms();
+}
+
+// Fills the location table and ties the Frame block to its binding.  Array
+// uniforms are listed as "name[0]", kept under "name" as well.
+void Shader::reflectUniforms() {
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::string name(static_cast<std::size_t>(maxLength), '\0');
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(ID, static_cast<GLuint>(i), maxLength, &length, &size, &type, &name[0]);
+        const std::string uniform = name.substr(0, static_cast<std::size_t>(length));
+        const GLint location = glGetUniformLocation(ID, uniform.c_str());
+        if (location < 0)
+            continue; // member of a uniform block
+        uniformLocations[uniform] = location;
+        const std::size_t bracket = uniform.find('[');
+        if (bracket != std::string::npos)
+            uniformLocations.emplace(uniform.substr(0, bracket), location);
+    }
+
+    const GLuint frameBlock = glGetUniformBlockIndex(ID, "Frame");
+    if (frameBlock != GL_INVALID_INDEX)
+        glUniformBlockBinding(ID, frameBlock, FRAME_BINDING);
 }
 
 void Shader::use() const {
     glUseProgram(ID);
 }
 
+GLint Shader::getUniformLocation(const std::string& name) const {
+    const auto it = uniformLocations.find(name);
+    return it != uniformLocations.end() ? it->second : -1;
+}
+
 void Shader::setInt(const std::string& name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    setInt(getUniformLocation(name), value);
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(mat));
+    setMat4(getUniformLocation(name), mat);
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& vec) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(vec));
+    setVec3(getUniformLocation(name), vec);
+}
+
+void Shader::setInt(GLint location, int value) const {
+    glUniform1i(location, value);
+}
+
+void Shader::setMat4(GLint location, const glm::mat4& mat) const {
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
+}
+
+void Shader::setVec3(GLint location, const glm::vec3& vec) const {
+    glUniform3fv(location, 1, glm::value_ptr(vec));
 }
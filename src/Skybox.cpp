@@ -29,12 +29,9 @@ Skybox::Skybox(const std::vector<std::string>& faces) {
     shader = std::make_unique<Shader>("shaders/skybox.vert", "shaders/skybox.frag");
 }
 
-void Skybox::draw(const glm::mat4& view, const glm::mat4& projection) const {
+void Skybox::draw() const {
     glDepthFunc(GL_LEQUAL);
     shader->use();
-    
-    shader->setMat4("view", glm::mat4(glm::mat3(view))); // remove camera translation
-    shader->setMat4("projection", projection);
 
     glBindVertexArray(skyboxVAO);
     glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
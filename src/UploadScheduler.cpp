@@ -0,0 +1,47 @@
+#include "UploadScheduler.hpp"
+#include "Chunk.hpp"
+#include "ChunkRenderer.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+void UploadScheduler::schedule(const std::pair<int, int> pos, const std::shared_ptr<Chunk> &chunk) {
+	pending[pos] = chunk;
+}
+
+void UploadScheduler::run(ChunkRenderer &renderer, const glm::vec3 &cameraPos,
+                          std::vector<std::shared_ptr<Chunk>> &uploaded) {
+	uploadedBytes = 0;
+	uploadedChunks = 0;
+	uploadMs = 0.0;
+	if (pending.empty())
+		return;
+	const auto start = std::chrono::steady_clock::now();
+
+	// Distance from the camera to the chunk centres
+	order.clear();
+	for (const auto &[pos, chunk] : pending) {
+		const float dx = (pos.first + 0.5f) * Chunk::WIDTH - cameraPos.x;
+		const float dz = (pos.second + 0.5f) * Chunk::DEPTH - cameraPos.z;
+		order.emplace_back(dx * dx + dz * dz, pos);
+	}
+	std::sort(order.begin(), order.end());
+
+	for (const auto &[distance, pos] : order) {
+		if (uploadedChunks != 0 && (uploadedBytes >= bytesPerFrame
+			|| std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= msPerFrame))
+			break;
+		const auto it = pending.find(pos);
+		const std::shared_ptr<Chunk> chunk = it->second.lock();
+		pending.erase(it);
+		if (!chunk)
+			continue;
+		const std::size_t bytes = chunk->getMeshDataVertexCount() * Chunk::VERTEX_WORDS * sizeof(uint32_t);
+		chunk->uploadMesh(renderer);
+		uploaded.push_back(chunk);
+		uploadedBytes += bytes;
+		++uploadedChunks;
+	}
+	renderer.flushWrites();
+	uploadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -3,6 +3,8 @@
 //
 
 #include "World.hpp"
+#include "MeshArena.hpp"
+
 
 
 // helper to write PPM
@@ -190,6 +192,180 @@ World::World(int seed) {
 }
 
 World::~World() {
+	stopUpdateThread();
+}
+
+void World::startUpdateThread() {
+	if (updateThread.joinable())
+		return;
+	stopRequested = false;
+	updateThread = std::thread(&World::runUpdateThread, this);
+}
+
+void World::stopUpdateThread() {
+	if (!updateThread.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(viewMutex);
+		stopRequested = true;
+	}
+	viewPosted.notify_one();
+	updateThread.join();
+}
+
+void World::setView(const glm::vec3 &cameraPos, const glm::vec3 &cameraDir) {
+	{
+		std::lock_guard<std::mutex> lock(viewMutex);
+		postedView = View{cameraPos, cameraDir, getParamsHandle()};
+		viewPending = true;
+	}
+	viewPosted.notify_one();
+}
+
+// One update per view posted.  Views posted during an update are merged
+// into the last one.
+void World::runUpdateThread() {
+	std::unique_lock<std::mutex> lock(viewMutex);
+	while (true) {
+		viewPosted.wait(lock, [this] { return viewPending || stopRequested; });
+		if (stopRequested)
+			return;
+		const View view = postedView;
+		viewPending = false;
+		lock.unlock();
+		update(view);
+		lock.lock();
+	}
+}
+
+void World::updateVisibleChunks(const glm::vec3& cameraPos, const glm::vec3& cameraDir) {
+	update(View{cameraPos, cameraDir, getParamsHandle()});
+}
+
+// Update thread.  A list the render thread did not take yet is replaced, its
+// mesh tasks go first in the new one.
+void World::publishRenderList() {
+	nextList.version = renderedChunksVersion;
+	nextList.chunks = renderedChunks;
+	nextList.totalChunks = chunks.size();
+	nextList.compressedChunks = compressedChunkCount;
+	nextList.compressedBytes = compressedBytes;
+	{
+		std::lock_guard<std::mutex> lock(publishMutex);
+		if (listPublished) {
+			std::vector<RenderList::MeshTask> &missed = publishedList.meshTasks;
+			nextList.meshTasks.insert(nextList.meshTasks.begin(), std::make_move_iterator(missed.begin()),
+			                          std::make_move_iterator(missed.end()));
+			if (!nextList.editTime)
+				nextList.editTime = publishedList.editTime;
+		}
+		std::swap(nextList, publishedList);
+		listPublished = true;
+	}
+	// Back from the render thread, or the list replaced
+	nextList.meshTasks.clear();
+	nextList.editTime.reset();
+}
+
+// Render thread
+void World::takeRenderList() {
+	finishMeshReads();
+	{
+		std::lock_guard<std::mutex> lock(publishMutex);
+		if (!listPublished)
+			return;
+		std::swap(renderList, publishedList);
+		listPublished = false;
+	}
+	for (RenderList::MeshTask &task : renderList.meshTasks) {
+		switch (task.type) {
+		case RenderList::MeshTask::QUEUE_UPLOAD:
+			uploadScheduler.schedule(task.pos, task.chunk);
+			break;
+		case RenderList::MeshTask::UPLOAD:
+			task.chunk->uploadMesh(renderer);
+			changedMeshes.push_back(task.chunk);
+			break;
+		case RenderList::MeshTask::READ_BACK: {
+			PendingMeshRead pending{task.pos, {}};
+			if (task.chunk->startMeshRead(pending.read))
+				meshReads.push_back(std::move(pending));
+			break;
+		}
+		case RenderList::MeshTask::RELEASE:
+			task.chunk->releaseGL();
+			changedMeshes.push_back(task.chunk);
+			break;
+		}
+	}
+	// Chunks unloaded since may go with their tasks
+	renderList.meshTasks.clear();
+	renderer.flushWrites();
+	if (renderList.editTime)
+		editLatencyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - *renderList.editTime).count();
+}
+
+// Render thread.  The copies were queued a frame or more ago, this does not
+// wait on the GPU.
+void World::finishMeshReads() {
+	std::size_t kept = 0;
+	for (PendingMeshRead &pending : meshReads) {
+		ChunkMeshData mesh;
+		if (Chunk::finishMeshRead(renderer, pending.read, mesh)) {
+			meshCache.store(pending.pos.first, pending.pos.second, std::move(mesh));
+			continue;
+		}
+		if (&meshReads[kept] != &pending)
+			meshReads[kept] = std::move(pending);
+		++kept;
+	}
+	meshReads.resize(kept);
+}
+
+void World::update(const View &view) {
+	updateParams = view.params;
+	applyCommands();
+	updateChunks(view.position, view.direction);
+
+	const int cameraX = static_cast<int>(std::floor(view.position.x));
+	const int cameraZ = static_cast<int>(std::floor(view.position.z));
+	nextList.surfaceHeight = getSurfaceHeight(cameraX, cameraZ);
+	nextList.target = raycastBlock(view.position, view.direction, TARGET_DISTANCE);
+	publishRenderList();
+}
+
+void World::applyCommands() {
+	{
+		std::lock_guard<std::mutex> lock(commandMutex);
+		std::swap(edits, postedEdits);
+	}
+	std::vector<BlockEdit> waiting;
+	for (const BlockEdit &edit : edits) {
+		if (!applyBlockEdit(edit))
+			waiting.push_back(edit);
+	}
+	edits.clear();
+	if (!waiting.empty()) {
+		std::lock_guard<std::mutex> lock(commandMutex);
+		postedEdits.insert(postedEdits.begin(), waiting.begin(), waiting.end());
+	}
+
+	// Remeshed like the level of detail changes, without counting as edits
+	if (rebuildRequested.exchange(false)) {
+		for (const auto &weak : renderedChunks) {
+			auto chunk = weak.lock();
+			if (!chunk || !chunk->hasMesh())
+				continue;
+			const glm::ivec3 origin = chunk->getGlobalCoords();
+			dirtyMeshes[toKey(floorDiv(origin.x, Chunk::WIDTH), floorDiv(origin.z, Chunk::DEPTH))] |= 1 << ChunkMeshData::INTERIOR;
+		}
+	}
+}
+
+TerrainParamsHandle World::getParamsHandle() {
+	if (!paramsHandle || *paramsHandle != terrainParams)
+		paramsHandle = std::make_shared<const TerrainGenerationParams>(terrainParams);
+	return paramsHandle;
 }
 
 ChunkPos World::toKey(int chunkX, int chunkZ) {
@@ -207,22 +383,17 @@ std::shared_ptr<Chunk> World::getChunk(int chunkX, int chunkZ) {
 
 std::vector<std::weak_ptr<Chunk>> World::getRenderedChunks()
 {
-	return renderedChunks;
+	return renderList.chunks;
 }
 
 void World::globalCoordsToLocalCoords(int &x, int &y, int &z, int globalX, int globalY, int globalZ, int &chunkX, int &chunkZ)
 {
-	x = (globalX % Chunk::WIDTH + Chunk::WIDTH) % Chunk::WIDTH;
-	z = (globalZ % Chunk::DEPTH + Chunk::DEPTH) % Chunk::DEPTH;
-	y = globalY;
-
-	chunkX = globalX / Chunk::WIDTH;
-	if (globalX < 0 && globalX % Chunk::WIDTH != 0)
-		chunkX--;
+	chunkX = floorDiv(globalX, Chunk::WIDTH);
+	chunkZ = floorDiv(globalZ, Chunk::DEPTH);
 
-	chunkZ = globalZ / Chunk::DEPTH;
-	if (globalZ < 0 && globalZ % Chunk::DEPTH != 0)
-		chunkZ--;
+	x = globalX - chunkX * Chunk::WIDTH;
+	z = globalZ - chunkZ * Chunk::DEPTH;
+	y = globalY;
 }
 
 BlockType World::getBlockWorld(glm::ivec3 globalCoords)
@@ -240,11 +411,17 @@ BlockType World::getBlockWorld(glm::ivec3 globalCoords)
 }
 
 void World::setBlockWorld(glm::ivec3 globalCoords, std::optional<glm::ivec3> faceNormal, BlockType type)
+{
+    std::lock_guard<std::mutex> lock(commandMutex);
+    postedEdits.push_back(BlockEdit{globalCoords, faceNormal, type, std::chrono::steady_clock::now()});
+}
+
+bool World::applyBlockEdit(const BlockEdit &edit)
 {
     // Offset the global coordinates in the direction of the face normal
-    glm::ivec3 targetCoords = globalCoords;
-    if (faceNormal.has_value()) {
-        targetCoords += *faceNormal;
+    glm::ivec3 targetCoords = edit.coords;
+    if (edit.faceNormal.has_value()) {
+        targetCoords += *edit.faceNormal;
     }
 
     int x, y, z;
@@ -255,10 +432,146 @@ void World::setBlockWorld(glm::ivec3 globalCoords, std::optional<glm::ivec3> fac
 
     auto it = chunks.find(std::make_pair(chunkX, chunkZ));
     if (it == chunks.end())
-        return;
+        return true;
+    // A compression job reads the voxels, a decompression job is about to
+    // replace them
+    if (coldTransitions.count(it->first))
+        return false;
 
     std::shared_ptr<Chunk> currChunk = it->second;
-    currChunk->setBlock(x, y, z, type);
+    currChunk->setBlock(x, y, z, edit.type);
+
+    // The chunk is remeshed in full, a neighbour only needs the strip facing
+    // an edited border cell (a block at level 0)
+    const int cell = 1 << currChunk->getLod();
+    markMeshDirty(toKey(chunkX, chunkZ), 1 << ChunkMeshData::INTERIOR, edit.time);
+    if (x < cell)
+        markMeshDirty(toKey(chunkX - 1, chunkZ), 1 << EAST, edit.time);
+    if (x >= Chunk::WIDTH - cell)
+        markMeshDirty(toKey(chunkX + 1, chunkZ), 1 << WEST, edit.time);
+    if (z < cell)
+        markMeshDirty(toKey(chunkX, chunkZ - 1), 1 << NORTH, edit.time);
+    if (z >= Chunk::DEPTH - cell)
+        markMeshDirty(toKey(chunkX, chunkZ + 1), 1 << SOUTH, edit.time);
+    return true;
+}
+
+void World::markMeshDirty(const ChunkPos pos, const uint8_t parts, const std::chrono::steady_clock::time_point editTime) {
+    if (!dirtyMeshesHaveEdit)
+        firstDirtyEdit = editTime;
+    dirtyMeshesHaveEdit = true;
+    dirtyMeshes[pos] |= parts;
+}
+
+void World::updateDirtyMeshes() {
+    if (!remeshJobs.empty()) {
+        for (auto &job : remeshJobs) {
+            if (job.mesh.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                return;
+        }
+        for (auto &job : remeshJobs) {
+            ChunkMeshData mesh = job.mesh.get();
+            // Unloaded or deflated while the job ran
+            if (getChunk(job.pos.first, job.pos.second) != job.chunk || job.chunk->isCompressed())
+                continue;
+
+            // Neighbours linked after the snapshot still need their strip
+            const uint8_t missingStrips = job.chunk->getLinkedBorders() & ~mesh.builtParts;
+            job.chunk->setMeshData(std::move(mesh));
+            nextList.meshTasks.push_back({RenderList::MeshTask::UPLOAD, job.pos, job.chunk});
+            if (missingStrips)
+                dirtyMeshes[job.pos] |= missingStrips;
+        }
+        remeshJobs.clear();
+        if (remeshBatchHasEdit)
+            nextList.editTime = remeshBatchEdit;
+    }
+    if (dirtyMeshes.empty())
+        return;
+
+    remeshBatchHasEdit = dirtyMeshesHaveEdit;
+    remeshBatchEdit = firstDirtyEdit;
+    dirtyMeshesHaveEdit = false;
+    for (auto it = dirtyMeshes.begin(); it != dirtyMeshes.end() && remeshJobs.size() < maxRemeshBatch; ) {
+        const ChunkPos pos = it->first;
+        const uint8_t parts = it->second;
+        // Kept until the first mesh job of the chunk is done
+        if (meshingChunks.count(pos)) {
+            ++it;
+            continue;
+        }
+        it = dirtyMeshes.erase(it);
+        std::shared_ptr<Chunk> chunk = getChunk(pos.first, pos.second);
+        // Chunks never meshed get the edit with their first mesh
+        if (!chunk || chunk->isCompressed() || !chunk->hasMesh())
+            continue;
+
+        RemeshJob job{pos, chunk, {}};
+        if ((parts & (1 << ChunkMeshData::INTERIOR)) || !chunk->canPatchBorderStrips()) {
+            MeshArena::Handle arena = MeshArena::acquire();
+            chunk->takeSnapshot(arena->snapshot);
+            job.mesh = std::async(std::launch::async, [arena = std::move(arena)]() {
+                ChunkMeshData mesh;
+                Chunk::buildMeshData(arena->snapshot, mesh);
+                return mesh;
+            });
+        } else {
+            // Current parts with the dirty strips rebuilt
+            auto snapshots = std::make_shared<std::array<ChunkSnapshot, 4>>();
+            for (int dir = 0; dir < 4; ++dir) {
+                if (parts & (1 << dir))
+                    chunk->takeBorderSnapshot((*snapshots)[dir], static_cast<Direction>(dir));
+            }
+            job.mesh = std::async(std::launch::async, [parts, snapshots, mesh = chunk->getMeshData()]() mutable {
+                for (int dir = 0; dir < 4; ++dir) {
+                    if (parts & (1 << dir))
+                        Chunk::buildBorderStrip((*snapshots)[dir], static_cast<Direction>(dir), mesh);
+                }
+                return std::move(mesh);
+            });
+        }
+        remeshJobs.push_back(std::move(job));
+    }
+    // Edits left over for the next batch keep their timestamp
+    if (!dirtyMeshes.empty() && remeshBatchHasEdit)
+        dirtyMeshesHaveEdit = true;
+}
+
+int World::selectLod(const int currentLod, const glm::vec3 &cameraPos, const int chunkX, const int chunkZ) const {
+    if (!lodEnabled)
+        return 0;
+    const float distance = glm::length(glm::vec2((chunkX + 0.5f) * Chunk::WIDTH - cameraPos.x,
+                                                 (chunkZ + 0.5f) * Chunk::DEPTH - cameraPos.z));
+    int lod = currentLod;
+    while (lod < Chunk::MAX_LOD && distance > (lod + 1) * LOD_RING_BLOCKS + LOD_HYSTERESIS_BLOCKS)
+        ++lod;
+    while (lod > 0 && distance < lod * LOD_RING_BLOCKS - LOD_HYSTERESIS_BLOCKS)
+        --lod;
+    return lod;
+}
+
+// Remesh a chunk whose level changed.  A neighbour reads the border of this
+// chunk only while both are at the same level, a skirt closes the side
+// otherwise: the strip facing this chunk is rebuilt when the chunk joins or
+// leaves the level of the neighbour.
+void World::updateLevelOfDetail(const int chunkX, const int chunkZ, Chunk &chunk, const glm::vec3 &cameraPos) {
+    const int oldLod = chunk.getLod();
+    const int newLod = selectLod(oldLod, cameraPos, chunkX, chunkZ);
+    if (newLod == oldLod || chunk.isCompressed())
+        return;
+    chunk.setLod(newLod);
+
+    const int dirX[] = { 0, 0, 1, -1 };
+    const int dirZ[] = { 1, -1, 0, 0 };
+    const int opp[]  = { SOUTH, NORTH, WEST, EAST };
+    for (int dir = 0; dir < 4; ++dir) {
+        std::shared_ptr<Chunk> neighbor = getChunk(chunkX + dirX[dir], chunkZ + dirZ[dir]);
+        if (neighbor && (neighbor->getLod() == oldLod) != (neighbor->getLod() == newLod))
+            dirtyMeshes[toKey(chunkX + dirX[dir], chunkZ + dirZ[dir])] |= 1 << opp[dir];
+    }
+
+    if (chunk.hasMesh() || meshingChunks.count(toKey(chunkX, chunkZ)))
+        dirtyMeshes[toKey(chunkX, chunkZ)] |= 1 << ChunkMeshData::INTERIOR;
 }
 
 bool World::isBlockVisibleWorld(glm::ivec3 globalCoords)
@@ -276,10 +589,68 @@ bool World::isBlockVisibleWorld(glm::ivec3 globalCoords)
 	return currChunk->isBlockVisible(glm::vec3(x, y ,z));
 }
 
-std::unordered_set<ChunkPos> World::linkNeighbors(int chunkX, int chunkZ, std::shared_ptr<Chunk> &chunk) {
-	std::unordered_set<ChunkPos> chunksToBuild;
+std::optional<int> World::getSurfaceHeight(int globalX, int globalZ)
+{
+	int x, y, z;
+	int chunkX, chunkZ;
+	globalCoordsToLocalCoords(x, y, z, globalX, 0, globalZ, chunkX, chunkZ);
+
+	auto it = chunks.find(std::make_pair(chunkX, chunkZ));
+	if (it == chunks.end())
+		return std::nullopt;
 
-	if (!chunk) return chunksToBuild;
+	const int height = it->second->getColumnHeight(x, z);
+	if (height < 0)
+		return std::nullopt;
+	return height;
+}
+
+// Grid traversal from the block holding the origin, one block boundary at a time
+std::optional<TargetedBlock> World::raycastBlock(const glm::vec3 &origin, const glm::vec3 &direction, const float maxDistance)
+{
+    const glm::vec3 rayDir = glm::normalize(direction);
+    glm::ivec3 blockPos = glm::floor(origin);
+
+    const glm::vec3 deltaDist = glm::abs(glm::vec3(1.0f) / rayDir);
+    glm::ivec3 step;
+    glm::vec3 sideDist;
+    for (int i = 0; i < 3; ++i) {
+        if (rayDir[i] < 0) {
+            step[i] = -1;
+            sideDist[i] = (origin[i] - blockPos[i]) * deltaDist[i];
+        } else {
+            step[i] = 1;
+            sideDist[i] = (blockPos[i] + 1.0f - origin[i]) * deltaDist[i];
+        }
+    }
+
+    float distanceTraveled = 0.0f;
+    while (distanceTraveled < maxDistance) {
+        int axis;
+        if (sideDist.x < sideDist.y)
+            axis = sideDist.x < sideDist.z ? 0 : 2;
+        else
+            axis = sideDist.y < sideDist.z ? 1 : 2;
+
+        blockPos[axis] += step[axis];
+        sideDist[axis] += deltaDist[axis];
+        distanceTraveled = glm::min(glm::min(sideDist.x, sideDist.y), sideDist.z);
+
+        if (isBlockVisibleWorld(blockPos)) {
+            glm::ivec3 faceNormal(0);
+            faceNormal[axis] = -step[axis];
+            return TargetedBlock{blockPos, faceNormal};
+        }
+    }
+    return std::nullopt;
+}
+
+// Links chunk both ways with its loaded neighbours.  Each side where both
+// chunks hold voxels needs its border strips built, they are added to
+// borderStrips as Direction bits.
+void World::linkNeighbors(int chunkX, int chunkZ, std::shared_ptr<Chunk> &chunk,
+                          std::unordered_map<ChunkPos, uint8_t> &borderStrips) {
+	if (!chunk) return;
 
     const int dirX[] = { 0, 0, 1, -1 };
     const int dirZ[] = { 1, -1, 0, 0 };
@@ -292,20 +663,18 @@ std::unordered_set<ChunkPos> World::linkNeighbors(int chunkX, int chunkZ, std::s
         std::shared_ptr<Chunk> neighbor = getChunk(nx, nz);
 
         chunk->setAdjacentChunks(static_cast<Direction>(dir), neighbor);
-		if (chunk->hasAllAdjacentChunkLoaded())
-			chunksToBuild.insert(toKey(chunkX, chunkZ));
         if (neighbor) {
             neighbor->setAdjacentChunks(opp[dir], chunk);
 
-            if (neighbor->hasAllAdjacentChunkLoaded()) {
-				chunksToBuild.insert(toKey(nx, nz));
+            if (!chunk->isCompressed() && !neighbor->isCompressed()) {
+				borderStrips[toKey(chunkX, chunkZ)] |= 1 << dir;
+				borderStrips[toKey(nx, nz)] |= 1 << opp[dir];
             }
         }
     }
-	return chunksToBuild;
 }
 
-void World::updateVisibleChunks(const glm::vec3& cameraPos, const glm::vec3& cameraDir) {
+void World::updateChunks(const glm::vec3& cameraPos, const glm::vec3& cameraDir) {
     // Unload distant chunks to free memory.  Chunks beyond (loadRadius + 2)
     // in a circular distance from the camera are removed.  We copy the keys
     // to a temporary list to avoid invalidating the iterator while erasing.
@@ -313,6 +682,8 @@ void World::updateVisibleChunks(const glm::vec3& cameraPos, const glm::vec3& cam
     const int currentChunkX = static_cast<int>(std::floor(cameraPos.x / Chunk::WIDTH));
     const int currentChunkZ = static_cast<int>(std::floor(cameraPos.z / Chunk::DEPTH));
 
+	updateDirtyMeshes();
+
 	if (false) {
 		try {
 			updateRegionStreaming(currentChunkX, currentChunkZ);
@@ -323,7 +694,7 @@ void World::updateVisibleChunks(const glm::vec3& cameraPos, const glm::vec3& cam
 		}
 	} else {
 		//remove chunks to not go out of memory;
-		const int unloadRadius = loadRadius + 32;
+		const int unloadRadius = loadRadius + UNLOAD_MARGIN_BLOCKS / Chunk::WIDTH;
 		std::vector<ChunkPos> toRemove;
 		for (const auto& entry : chunks) {
 			const int cx = entry.first.first;
@@ -335,6 +706,7 @@ void World::updateVisibleChunks(const glm::vec3& cameraPos, const glm::vec3& cam
 			}
 		}
 		for (auto k : toRemove){
+			cacheMesh(k, chunks[k]);
 			chunks.erase(k);
 		}
 	}
@@ -379,8 +751,8 @@ void World::updateVisibleChunks(const glm::vec3& cameraPos, const glm::vec3& cam
         std::shared_ptr<Chunk> chunk = getChunk(cx, cz);
 
         if (!chunk && amountOfConcurrentChunksBeingGenerated < maxConcurrentGeneration) {
-            generationFutures.push_back(std::async(std::launch::async, [=]() {
-                std::shared_ptr<Chunk> newChunk = std::make_shared<Chunk>(cx, cz, terrainParams);
+            generationFutures.push_back(std::async(std::launch::async, [cx, cz, key, params = updateParams]() {
+                std::shared_ptr<Chunk> newChunk = std::make_shared<Chunk>(cx, cz, params);
                 return std::make_pair(key, newChunk);
             }));
             amountOfConcurrentChunksBeingGenerated++;
@@ -403,6 +775,10 @@ void World::updateVisibleChunks(const glm::vec3& cameraPos, const glm::vec3& cam
 	// Set of chunks currently being generated asynchronously.  We use
     // ChunkKey pairs to avoid scheduling the same chunk multiple times.
 
+	// Chunks coming back from the cold tier go through the same linking and
+	// meshing path as freshly generated ones.
+	updateColdTier(currentChunkX, currentChunkZ, generatingChunks);
+
 	std::size_t processed = 0;
 	for (auto it = generationFutures.begin(); it != generationFutures.end(); ) {
 		std::future<std::pair<ChunkPos, std::shared_ptr<Chunk>>>& fut = *it;
@@ -421,46 +797,111 @@ void World::updateVisibleChunks(const glm::vec3& cameraPos, const glm::vec3& cam
 		}
 	}
 
+	std::unordered_map<ChunkPos, uint8_t> borderStrips;
 	for (auto [chunkX, chunkZ] : generatingChunks) {
 		std::shared_ptr<Chunk> currChunk = getChunk(chunkX, chunkZ);
-		linkNeighbors(chunkX, chunkZ, currChunk);
+		linkNeighbors(chunkX, chunkZ, currChunk, borderStrips);
 	}
 
-	std::vector<std::future<ChunkPos>> meshFutures;
+	std::unordered_set<ChunkPos> chunksToUpload;
 
-	std::unordered_set<ChunkPos> chunksToBuild;
-	for (auto [chunkX, chunkZ] : generatingChunks) {
-		std::shared_ptr<Chunk> currChunk = getChunk(chunkX, chunkZ);
-		chunksToBuild.merge(linkNeighbors(chunkX, chunkZ, currChunk));
+	auto scheduleFullMesh = [&](int chunkX, int chunkZ, const std::shared_ptr<Chunk> &currChunk) {
+		const ChunkPos key = toKey(chunkX, chunkZ);
+		const auto meshing = meshingChunks.find(key);
+		const bool remeshing = std::any_of(remeshJobs.begin(), remeshJobs.end(),
+		                                   [&](const RemeshJob &job) { return job.chunk == currChunk; });
+		if ((meshing != meshingChunks.end() && meshing->second == currChunk.get()) || remeshing) {
+			dirtyMeshes[key] |= 1 << ChunkMeshData::INTERIOR;
+			return;
+		}
+		// The job only reads this copy, not the chunk or its neighbours.  The
+		// snapshot lives in a pooled arena so its blocks are not reallocated.
+		MeshArena::Handle arena = MeshArena::acquire();
+		currChunk->takeSnapshot(arena->snapshot);
+		meshingChunks[key] = currChunk.get();
+		meshJobs.push_back({key, currChunk, std::async(std::launch::async, [this, chunkX, chunkZ, arena = std::move(arena)]() {
+			// A chunk seen before reuses its cached mesh if its voxels did not change
+			ChunkMeshData cached;
+			if (meshCache.take(chunkX, chunkZ, cached) && Chunk::refreshCachedMesh(arena->snapshot, cached)) {
+				++reusedMeshes;
+				return cached;
+			}
+			ChunkMeshData mesh;
+			Chunk::buildMeshData(arena->snapshot, mesh);
+			return mesh;
+		})});
+	};
+
+	// New chunks are meshed right away, without waiting for their four
+	// neighbours: interior plus the strips of the sides already linked.
+	for (const auto &chunkPos : generatingChunks) {
+		std::shared_ptr<Chunk> currChunk = getChunk(chunkPos.first, chunkPos.second);
+		borderStrips.erase(chunkPos);
+		if (currChunk && !currChunk->isCompressed()) {
+			currChunk->setLod(selectLod(currChunk->getLod(), cameraPos, chunkPos.first, chunkPos.second));
+			scheduleFullMesh(chunkPos.first, chunkPos.second, currChunk);
+		}
 	}
 
-    for (const auto& chunkPos : chunksToBuild) {
-        int chunkX = chunkPos.first;
-        int chunkZ = chunkPos.second;
-        std::shared_ptr<Chunk> currChunk = getChunk(chunkX, chunkZ);
+	// Chunks already meshed only get the strips facing their new neighbours,
+	// built here while the mesh jobs run
+	for (const auto &[chunkPos, strips] : borderStrips) {
+		std::shared_ptr<Chunk> currChunk = getChunk(chunkPos.first, chunkPos.second);
+		// Chunks never meshed yet get their full mesh once they are generated.
+		// A job in flight adds the strips missing from its snapshot when it
+		// is done.
+		if (!currChunk || currChunk->isCompressed() || !currChunk->hasMesh() || meshingChunks.count(chunkPos))
+			continue;
+		// Chunks above level 0 have a skirt on the new side, it only goes for
+		// a neighbour at the same level
+		if (currChunk->getLod() != 0 && !(strips & currChunk->getSameLodBorders()))
+			continue;
+		if (!currChunk->canPatchBorderStrips()) {
+			scheduleFullMesh(chunkPos.first, chunkPos.second, currChunk);
+			continue;
+		}
 
-        if (currChunk) 
-        {
-            meshFutures.push_back(std::async(std::launch::async, [chunkX, chunkZ, currChunk]() {
-                currChunk->buildMeshData();
-                return toKey(chunkX, chunkZ);
-            }));
-        }
-    }
+		ChunkSnapshot snapshot;
+		for (int dir = 0; dir < 4; ++dir) {
+			if (!(strips & (1 << dir)))
+				continue;
+			currChunk->takeBorderSnapshot(snapshot, static_cast<Direction>(dir));
+			currChunk->buildBorderStrip(snapshot, static_cast<Direction>(dir));
+		}
+		chunksToUpload.insert(chunkPos);
+	}
 
-	for (auto it = meshFutures.begin(); it != meshFutures.end();) {
-		ChunkPos pos = it->get();
-		auto chunk = getChunk(pos.first, pos.second);
-		if (chunk) {
-			chunk->uploadMesh();
+	// Take the mesh jobs done, the others are looked at again by the next update
+	for (auto it = meshJobs.begin(); it != meshJobs.end(); ) {
+		if (it->mesh.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			++it;
+			continue;
 		}
-		it = meshFutures.erase(it);
+		ChunkMeshData mesh = it->mesh.get();
+		const auto meshing = meshingChunks.find(it->pos);
+		if (meshing != meshingChunks.end() && meshing->second == it->chunk.get())
+			meshingChunks.erase(meshing);
+		// Unloaded or deflated while the job ran
+		if (getChunk(it->pos.first, it->pos.second) == it->chunk && !it->chunk->isCompressed()) {
+			// Neighbours linked after the snapshot still need their strip
+			const uint8_t missingStrips = it->chunk->getLinkedBorders() & ~mesh.builtParts;
+			it->chunk->setMeshData(std::move(mesh));
+			chunksToUpload.insert(it->pos);
+			if (missingStrips)
+				dirtyMeshes[it->pos] |= missingStrips;
+		}
+		it = meshJobs.erase(it);
+	}
+	for (const auto &chunkPos : chunksToUpload) {
+		if (auto chunk = getChunk(chunkPos.first, chunkPos.second))
+			nextList.meshTasks.push_back({RenderList::MeshTask::QUEUE_UPLOAD, chunkPos, chunk});
 	}
 
     // Rebuild the renderedChunks list again after newly generated chunks may
     // have been inserted.  This ensures that chunks created this frame are
     // included in the rendering pass.  We simply iterate the same radius
     // again and collect loaded chunks.
+    std::vector<std::weak_ptr<Chunk>> previousChunks = std::move(renderedChunks);
     renderedChunks.clear();
     for (int dx = -loadRadius; dx <= loadRadius; ++dx) {
         for (int dz = -loadRadius; dz <= loadRadius; ++dz) {
@@ -471,30 +912,167 @@ void World::updateVisibleChunks(const glm::vec3& cameraPos, const glm::vec3& cam
             const int cz = currentChunkZ + dz;
             std::shared_ptr<Chunk> chunk = getChunk(cx, cz);
             if (chunk) {
+                updateLevelOfDetail(cx, cz, *chunk, cameraPos);
                 renderedChunks.push_back(chunk);
             }
         }
     }
+    // The renderer keeps its draw commands while the list stays the same
+    auto sameChunk = [](const std::weak_ptr<Chunk> &a, const std::weak_ptr<Chunk> &b) {
+        return !a.owner_before(b) && !b.owner_before(a);
+    };
+    if (!std::equal(renderedChunks.begin(), renderedChunks.end(), previousChunks.begin(), previousChunks.end(), sameChunk))
+        ++renderedChunksVersion;
+}
+
+void World::render(const std::shared_ptr<Shader> &shaderProgram, const glm::vec3 &cameraPos,
+                   const glm::mat4 &viewProjection) {
+    takeRenderList();
+    uploadScheduler.run(renderer, cameraPos, changedMeshes);
+
+    // The occupied Y range of a chunk changes with its blocks, which are
+    // uploaded again when they do.  The table is patched for those chunks
+    // and only rebuilt with the chunk list or when one turns empty or back.
+    if (renderList.version != culledChunksVersion || !culler.updateChunks(changedMeshes)) {
+        culler.setChunks(renderList.chunks);
+        culledChunksVersion = renderList.version;
+    }
+    changedMeshes.clear();
+    const std::vector<ChunkRenderer::VisibleChunk> &visibleChunks = culler.cull(viewProjection, cameraPos);
+    shaderProgram->use();
+    renderer.draw(visibleChunks, culler.getVisibleVersion(), cameraPos);
+}
+
+void World::releaseGL() {
+    stopUpdateThread();
+    uploadScheduler.clear();
+    changedMeshes.clear();
+    for (PendingMeshRead &pending : meshReads)
+        ChunkRenderer::cancelRead(pending.read.gpu);
+    meshReads.clear();
+    renderList.meshTasks.clear();
+    publishedList.meshTasks.clear();
+    nextList.meshTasks.clear();
+    renderer.releaseGL();
 }
 
-void World::render(const std::shared_ptr<Shader> &shaderProgram) const {
-    int count = 0;
-	for (auto& weakChunk : renderedChunks) {
-		if (auto chunk = weakChunk.lock()) {
-			chunk->draw(shaderProgram);
-			count++;
+void World::updateColdTier(int currentChunkX, int currentChunkZ, std::unordered_set<ChunkPos> &restoredChunks) {
+	const int coldRadius = loadRadius + coldMargin;
+	const int warmRadius = loadRadius + warmMargin;
+
+	auto distanceSq = [&](const ChunkPos &key) {
+		const int dx = key.first - currentChunkX;
+		const int dz = key.second - currentChunkZ;
+		return dx * dx + dz * dz;
+	};
+
+	// Apply finished compressions.  The result is dropped if the chunk was
+	// unloaded, edited or the camera came back while the job was running.
+	for (auto it = compressionFutures.begin(); it != compressionFutures.end(); ) {
+		if (it->wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			++it;
+			continue;
+		}
+		auto result = it->get();
+		it = compressionFutures.erase(it);
+		const uint32_t startEditCount = coldTransitions[result.first];
+		coldTransitions.erase(result.first);
+
+		std::shared_ptr<Chunk> chunk = getChunk(result.first.first, result.first.second);
+		if (chunk && chunk->getEditCount() == startEditCount
+			&& distanceSq(result.first) > warmRadius * warmRadius && !result.second.empty()) {
+			cacheMesh(result.first, chunk);
+			chunk->storeCompressed(std::move(result.second));
+			nextList.meshTasks.push_back({RenderList::MeshTask::RELEASE, result.first, chunk});
+		}
+	}
+
+	// Apply finished decompressions
+	for (auto it = decompressionFutures.begin(); it != decompressionFutures.end(); ) {
+		if (it->wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			++it;
+			continue;
+		}
+		auto result = it->get();
+		it = decompressionFutures.erase(it);
+		coldTransitions.erase(result.first);
+
+		std::shared_ptr<Chunk> chunk = getChunk(result.first.first, result.first.second);
+		if (chunk && chunk->isCompressed() && !result.second.empty()) {
+			chunk->restoreFromRaw(result.second);
+			restoredChunks.insert(result.first);
+		}
+	}
+
+	// Schedule new transitions and refresh the statistics
+	compressedChunkCount = 0;
+	compressedBytes = 0;
+	for (const auto &[key, chunk] : chunks) {
+		const int dist = distanceSq(key);
+		if (chunk->isCompressed()) {
+			compressedChunkCount++;
+			compressedBytes += chunk->getCompressedBlocks().size();
+		}
+		if (coldTransitions.count(key))
+			continue;
+
+		if (!chunk->isCompressed() && dist > coldRadius * coldRadius
+			&& compressionFutures.size() < maxConcurrentCompression) {
+			coldTransitions[key] = chunk->getEditCount();
+			compressionFutures.push_back(std::async(std::launch::async, [key, chunk]() {
+				return std::make_pair(key, chunk->compressBlocks());
+			}));
+		}
+		else if (chunk->isCompressed() && dist <= warmRadius * warmRadius
+			&& decompressionFutures.size() < maxConcurrentCompression) {
+			coldTransitions[key] = chunk->getEditCount();
+			decompressionFutures.push_back(std::async(std::launch::async, [key, chunk]() {
+				std::string raw;
+				if (!Chunk::inflateBlocks(chunk->getCompressedBlocks(), raw))
+					raw.clear();
+				return std::make_pair(key, std::move(raw));
+			}));
 		}
 	}
 }
 
+// Chunks with edits waiting for a remesh are left out, their mesh would not
+// match their voxels anyway.  A mesh whose parts left the CPU is read back
+// from the GPU by the render thread, see finishMeshReads.
+void World::cacheMesh(const ChunkPos pos, const std::shared_ptr<Chunk> &chunk) {
+	if (chunk->isCompressed() || dirtyMeshes.count(pos))
+		return;
+	ChunkMeshData mesh;
+	if (chunk->extractMeshData(mesh))
+		meshCache.store(pos.first, pos.second, std::move(mesh));
+	else if (chunk->hasMesh())
+		nextList.meshTasks.push_back({RenderList::MeshTask::READ_BACK, pos, chunk});
+}
+
 // Return the number of chunks currently in the rendered list.
 std::size_t World::getRenderedChunkCount() const {
-    return renderedChunks.size();
+    return renderList.chunks.size();
+}
+
+std::size_t World::getRenderedVertexCount() const {
+    std::size_t vertices = 0;
+    for (const auto &weak : renderList.chunks) {
+        if (auto chunk = weak.lock())
+            vertices += chunk->getMeshVertexCount();
+    }
+    return vertices;
+}
+
+void World::setMeshingMode(const MeshingMode mode) {
+    if (Chunk::getMeshingMode() == mode)
+        return;
+    Chunk::setMeshingMode(mode);
+    rebuildRenderedMeshes();
 }
 
 // Return the total number of chunks currently loaded in the world (in memory).
 std::size_t World::getTotalChunkCount() const {
-    return chunks.size();
+    return renderList.totalChunks;
 }
 
 void World::saveRegionsOnExit()
@@ -506,8 +1084,6 @@ void World::saveRegionsOnExit()
 }
 
 void World::updateRegionStreaming(int currentChunkX, int currentChunkZ) {
-    const int REGION_SIZE = 32;
-
     // Determine current region
     int regionX = floorDiv(currentChunkX, REGION_SIZE);
     int regionZ = floorDiv(currentChunkZ, REGION_SIZE);
@@ -577,6 +1153,7 @@ void World::saveRegion(int regionX, int regionZ) {
 
 			header[idx] = entry;
 
+			cacheMesh(it->first, it->second);
 			chunks.erase(it);
 		}
 	}
@@ -585,6 +1162,8 @@ void World::saveRegion(int regionX, int regionZ) {
     // --- Rewrite header with correct entries ---
     out.seekp(sizeof(metadata));
     out.write(reinterpret_cast<const char*>(header.data()), header.size() * sizeof(ChunkEntry));
+
+    meshCache.save(getMeshCacheFilename(regionX, regionZ), regionX * REGION_SIZE, regionZ * REGION_SIZE, REGION_SIZE);
 }
 
 
@@ -599,6 +1178,9 @@ void World::loadRegion(int regionX, int regionZ) {
     in.read(reinterpret_cast<char*>(&metadata), sizeof(metadata));
     if (std::strncmp(metadata.magic, "RGN1", 4) != 0)
         throw std::runtime_error("Invalid region file magic in " + filename);
+    if (metadata.version != RegionFileMetadata().version
+        || metadata.chunkWidth != Chunk::WIDTH || metadata.chunkHeight != Chunk::HEIGHT)
+        throw std::runtime_error("Region file " + filename + " was written with another format or chunk size");
 
     // --- Read header ---
     std::vector<ChunkEntry> header(REGION_SIZE * REGION_SIZE);
@@ -610,13 +1192,16 @@ void World::loadRegion(int regionX, int regionZ) {
 
         // Seek to the chunk data
         in.seekg(entry.offset);
-        auto chunk = std::make_shared<Chunk>(entry.X, entry.Z, terrainParams, false);
+        auto chunk = std::make_shared<Chunk>(entry.X, entry.Z, updateParams, false);
         chunk->loadFromStream(in);
 
         // Insert into chunk map
         ChunkPos pos(entry.X, entry.Z);
         chunks[pos] = chunk;
     }
+
+    // Meshes saved with the region, checked against the voxels when the chunks get meshed
+    meshCache.load(getMeshCacheFilename(regionX, regionZ));
 }
 
 std::string World::getRegionFilename(int regionX, int regionZ) const {
@@ -625,3 +1210,9 @@ std::string World::getRegionFilename(int regionX, int regionZ) const {
     ss << regionDirName + "/r." << regionX << "." << regionZ << ".rg";
     return ss.str();
 }
+
+std::string World::getMeshCacheFilename(int regionX, int regionZ) const {
+    std::ostringstream ss;
+    ss << regionDirName + "/r." << regionX << "." << regionZ << ".mesh";
+    return ss.str();
+}